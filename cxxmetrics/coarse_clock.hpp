@@ -0,0 +1,111 @@
+#ifndef CXXMETRICS_COARSE_CLOCK_HPP
+#define CXXMETRICS_COARSE_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief The background thread that keeps the coarse clock up to date
+ *
+ * The thread is started the first time the coarse clock is read and stopped when the process exits
+ */
+class coarse_clock_ticker
+{
+    std::atomic<std::chrono::steady_clock::rep> now_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    void run() noexcept;
+
+public:
+    /**
+     * \brief How often the ticker publishes a new time
+     */
+    static constexpr std::chrono::milliseconds resolution() noexcept
+    {
+        return std::chrono::milliseconds(1);
+    }
+
+    coarse_clock_ticker();
+    coarse_clock_ticker(const coarse_clock_ticker &) = delete;
+    coarse_clock_ticker &operator=(const coarse_clock_ticker &) = delete;
+    ~coarse_clock_ticker();
+
+    std::chrono::steady_clock::rep now() const noexcept
+    {
+        return now_.load(std::memory_order_relaxed);
+    }
+
+    static coarse_clock_ticker &instance()
+    {
+        static coarse_clock_ticker ticker;
+        return ticker;
+    }
+};
+
+inline coarse_clock_ticker::coarse_clock_ticker() :
+        now_(std::chrono::steady_clock::now().time_since_epoch().count()),
+        running_(true),
+        thread_([this]() { run(); })
+{ }
+
+inline coarse_clock_ticker::~coarse_clock_ticker()
+{
+    running_.store(false, std::memory_order_relaxed);
+    if (thread_.joinable())
+        thread_.join();
+}
+
+inline void coarse_clock_ticker::run() noexcept
+{
+    while (running_.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_for(resolution());
+        now_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+}
+
+}
+
+/**
+ * \brief A std::chrono style clock that follows the steady_clock at a resolution of about a millisecond
+ *
+ * Reading the clock is a single atomic load of the time published by a background thread, which is much cheaper than
+ * asking the system for the time on every update of a busy metric. Metrics with intervals shorter than the
+ * resolution will see several intervals' worth of updates land in one.
+ */
+struct coarse_clock
+{
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+        return time_point(duration(internal::coarse_clock_ticker::instance().now()));
+    }
+};
+
+/**
+ * \brief A TClockGet implementation using the coarse clock
+ */
+struct coarse_clock_point
+{
+    std::chrono::steady_clock::time_point operator()() const noexcept
+    {
+        return coarse_clock::now();
+    }
+};
+
+}
+
+#endif //CXXMETRICS_COARSE_CLOCK_HPP
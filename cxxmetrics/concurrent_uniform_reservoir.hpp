@@ -0,0 +1,299 @@
+#ifndef CXXMETRICS_CONCURRENT_UNIFORM_RESERVOIR_HPP
+#define CXXMETRICS_CONCURRENT_UNIFORM_RESERVOIR_HPP
+
+#include "snapshots.hpp"
+#include "internal/thread_random.hpp"
+#include "internal/thread_stripe.hpp"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <thread>
+
+namespace cxxmetrics
+{
+
+/**
+ * \brief A uniform reservoir for busy, multithreaded update paths
+ *
+ * Each thread updates the stripe for its thread index, and each stripe is a uniform sample of TSize values
+ * maintained with Vitter's Algorithm L. Once a stripe is full, each thread keeps its own countdown of the updates it
+ * skips before its next replacement, so most updates only touch thread local state and never the stripe, its lock or
+ * the random number generator. The skips are geometric, so splitting a stripe's updates between several threads
+ * counting down on their own doesn't change how likely any one value is to be kept.
+ *
+ * Snapshots draw from every stripe in proportion to how many values it has seen, so the result is still a
+ * uniform sample of at most TSize values. A thread's skipped updates are only added to its stripe's count at its next
+ * replacement, which is never more than a skip behind. A stripe's values are only allocated the first time it's
+ * updated.
+ *
+ * \tparam TElem the type of elements in the reservoir
+ * \tparam TSize the size of the reservoir
+ * \tparam TStripes the number of stripes to spread updates across
+ */
+template<typename TElem, std::size_t TSize, std::size_t TStripes = 16>
+class concurrent_uniform_reservoir
+{
+    static_assert(TSize > 0, "concurrent_uniform_reservoir needs to hold at least one value");
+    static_assert(TStripes > 0, "concurrent_uniform_reservoir needs at least one stripe");
+
+    struct stripe
+    {
+        std::atomic_flag lock;
+        uint64_t count;
+        uint64_t size;
+        double w;
+        std::unique_ptr<TElem[]> elems;
+
+        stripe() noexcept :
+                count(0),
+                size(0),
+                w(0)
+        {
+            lock.clear();
+        }
+
+        void acquire() noexcept
+        {
+            // a stripe's lock is only taken to fill it or replace a value, so this rarely spins
+            while (lock.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        void release() noexcept
+        {
+            lock.clear(std::memory_order_release);
+        }
+
+        void replace(const TElem& v) noexcept
+        {
+            elems[internal::thread_random() % TSize] = v;
+            w *= std::exp(std::log(internal::thread_random_unit()) / TSize);
+        }
+
+        uint64_t skips() const noexcept
+        {
+            return static_cast<uint64_t>(std::floor(std::log(internal::thread_random_unit()) / std::log1p(-w)));
+        }
+
+        void copy(const stripe& other)
+        {
+            count = other.count;
+            size = other.size;
+            w = other.w;
+            if (!other.elems)
+            {
+                elems.reset();
+                return;
+            }
+
+            if (!elems)
+                elems.reset(new TElem[TSize]);
+            for (std::size_t i = 0; i < size; i++)
+                elems[i] = other.elems[i];
+        }
+    };
+
+    /**
+     * \brief A thread's countdown to its next replacement in a reservoir
+     */
+    struct countdown
+    {
+        uint64_t owner;
+        uint64_t remaining;
+        uint64_t skipped;
+        bool armed;
+    };
+
+    static constexpr std::size_t countdown_slots = 64;
+
+    static countdown& local(uint64_t owner) noexcept
+    {
+        // reservoirs that land on the same slot take it from each other, losing the other's countdown and skipped count
+        static thread_local countdown slots[countdown_slots] = {};
+
+        auto& c = slots[owner % countdown_slots];
+        if (c.owner != owner)
+            c = countdown{owner, 0, 0, false};
+
+        return c;
+    }
+
+    static uint64_t next_id() noexcept
+    {
+        static std::atomic<uint64_t> ids(1);
+        return ids.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t id_;
+    internal::padded_stripe<stripe> stripes_[TStripes];
+
+    void copy_stripes(const concurrent_uniform_reservoir& other) noexcept;
+
+public:
+    using value_type = TElem;
+
+    /**
+     * \brief Construct a concurrent uniform reservoir
+     */
+    concurrent_uniform_reservoir() noexcept :
+            id_(next_id())
+    { }
+
+    /**
+     * \brief Copy constructor
+     */
+    concurrent_uniform_reservoir(const concurrent_uniform_reservoir& other) noexcept;
+    ~concurrent_uniform_reservoir() = default;
+
+    /**
+     * \brief Assignment operator
+     */
+    concurrent_uniform_reservoir& operator=(const concurrent_uniform_reservoir& other) noexcept;
+
+    /**
+     * \brief Update the reservoir with a value
+     */
+    void update(const TElem& v) noexcept;
+
+    /**
+     * \brief Get a snapshot of the reservoir
+     *
+     * \return a reservoir snapshot
+     */
+    basic_reservoir_snapshot<TElem> snapshot() const noexcept;
+};
+
+template<typename TElem, std::size_t TSize, std::size_t TStripes>
+concurrent_uniform_reservoir<TElem, TSize, TStripes>::concurrent_uniform_reservoir(const concurrent_uniform_reservoir& other) noexcept :
+        id_(next_id())
+{
+    copy_stripes(other);
+}
+
+template<typename TElem, std::size_t TSize, std::size_t TStripes>
+concurrent_uniform_reservoir<TElem, TSize, TStripes>& concurrent_uniform_reservoir<TElem, TSize, TStripes>::operator=(const concurrent_uniform_reservoir& other) noexcept
+{
+    if (this != &other)
+        copy_stripes(other);
+    return *this;
+}
+
+template<typename TElem, std::size_t TSize, std::size_t TStripes>
+void concurrent_uniform_reservoir<TElem, TSize, TStripes>::copy_stripes(const concurrent_uniform_reservoir& other) noexcept
+{
+    for (std::size_t i = 0; i < TStripes; i++)
+    {
+        auto& from = const_cast<internal::padded_stripe<stripe>&>(other.stripes_[i]);
+        auto& to = stripes_[i];
+
+        // lock in address order so copies going both ways at once can't deadlock
+        auto& first = (static_cast<stripe*>(&from) < static_cast<stripe*>(&to)) ? static_cast<stripe&>(from) : static_cast<stripe&>(to);
+        auto& second = (&first == &from) ? static_cast<stripe&>(to) : static_cast<stripe&>(from);
+        first.acquire();
+        second.acquire();
+        to.copy(from);
+        second.release();
+        first.release();
+    }
+}
+
+template<typename TElem, std::size_t TSize, std::size_t TStripes>
+void concurrent_uniform_reservoir<TElem, TSize, TStripes>::update(const TElem& v) noexcept
+{
+    auto& c = local(id_);
+    if (c.armed && c.remaining > 0)
+    {
+        --c.remaining;
+        ++c.skipped;
+        return;
+    }
+
+    auto& s = stripes_[internal::thread_stripe() % TStripes];
+    s.acquire();
+    s.count += c.skipped + 1;
+    c.skipped = 0;
+
+    if (s.size < TSize)
+    {
+        if (!s.elems)
+            s.elems.reset(new (std::nothrow) TElem[TSize]);
+        if (s.elems)
+            s.elems[s.size++] = v;
+        else
+            s.count--;
+
+        // the stripe just filled up, so start skipping
+        if (s.size == TSize)
+        {
+            s.w = std::exp(std::log(internal::thread_random_unit()) / TSize);
+            c.remaining = s.skips();
+            c.armed = true;
+        }
+    }
+    else if (c.armed)
+    {
+        // this update is the one the countdown was counting down to
+        s.replace(v);
+        c.remaining = s.skips();
+    }
+    else
+    {
+        // a thread that hasn't counted down in this stripe yet draws where its countdown starts from here
+        auto skips = s.skips();
+        if (skips == 0)
+        {
+            s.replace(v);
+            skips = s.skips();
+        }
+        else
+            --skips;
+
+        c.remaining = skips;
+        c.armed = true;
+    }
+
+    s.release();
+}
+
+template<typename TElem, std::size_t TSize, std::size_t TStripes>
+basic_reservoir_snapshot<TElem> concurrent_uniform_reservoir<TElem, TSize, TStripes>::snapshot() const noexcept
+{
+    std::vector<TElem> samples[TStripes];
+    uint64_t counts[TStripes];
+    uint64_t total = 0;
+
+    for (std::size_t i = 0; i < TStripes; i++)
+    {
+        auto& s = const_cast<internal::padded_stripe<stripe>&>(stripes_[i]);
+        s.acquire();
+        counts[i] = s.count;
+        if (s.elems)
+            samples[i].assign(s.elems.get(), s.elems.get() + s.size);
+        s.release();
+
+        total += counts[i];
+    }
+
+    std::vector<TElem> values;
+    values.reserve(std::min<uint64_t>(total, TSize));
+    for (std::size_t i = 0; i < TStripes; i++)
+    {
+        auto& sample = samples[i];
+
+        // each stripe gets its share of the snapshot based on how many values it's seen
+        auto take = (total <= TSize) ? sample.size() : std::min<std::size_t>(sample.size(), (counts[i] * TSize + total / 2) / total);
+        for (std::size_t j = 0; j < take; j++)
+        {
+            auto pick = j + internal::thread_random() % (sample.size() - j);
+            std::swap(sample[j], sample[pick]);
+            values.push_back(sample[j]);
+        }
+    }
+
+    return basic_reservoir_snapshot<TElem>(values.data(), values.size());
+}
+
+}
+
+#endif //CXXMETRICS_CONCURRENT_UNIFORM_RESERVOIR_HPP
@@ -162,6 +162,7 @@ template<typename TCount>
 counter<TCount> &counter<TCount>::operator=(const counter<TCount> &c) noexcept
 {
     value_ = c;
+    this->changed();
     return *this;
 }
 
@@ -170,6 +171,8 @@ counter<TCount> &counter<TCount>::operator=(counter<TCount>  &&c) noexcept
 {
     value_ = c;
     c.value_ = 0;
+    this->changed();
+    c.changed();
     return *this;
 }
 
@@ -177,13 +180,16 @@ template<typename TCount>
 counter<TCount> &counter<TCount>::operator=(TCount value) noexcept
 {
     value_ = value;
+    this->changed();
     return *this;
 }
 
 template<typename TCount>
 TCount counter<TCount>::incr(TCount by) noexcept
 {
-    return value_ += by;
+    auto result = value_ += by;
+    this->changed();
+    return result;
 }
 
 template<typename TCount>
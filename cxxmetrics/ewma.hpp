@@ -1,6 +1,7 @@
 #ifndef CXXMETRICS_EWMA_HPP
 #define CXXMETRICS_EWMA_HPP
 
+#include "coarse_clock.hpp"
 #include "metric.hpp"
 #include <cmath>
 #include <chrono>
@@ -77,6 +78,8 @@ public:
 
 private:
     static long double alpha_;
+    // ln(1 - alpha), so decaying over n idle intervals is a single exp
+    static long double log_decay_;
 
     TClockGet clk_;
     std::atomic<TValue> rate_;
@@ -113,6 +116,9 @@ public:
 template<typename TClockGet, period::value TWindow, period::value TInterval, typename TValue>
 long double ewma<TClockGet, TWindow, TInterval, TValue>::alpha_ = ewma<TClockGet, TWindow, TInterval, TValue>::get_alpha();
 
+template<typename TClockGet, period::value TWindow, period::value TInterval, typename TValue>
+long double ewma<TClockGet, TWindow, TInterval, TValue>::log_decay_ = std::log1p(-static_cast<long double>(ewma<TClockGet, TWindow, TInterval, TValue>::get_alpha()));
+
 template<typename TClockGet, period::value TWindow, period::value TInterval, typename TValue>
 ewma<TClockGet, TWindow, TInterval, TValue>::ewma(const TClockGet &clock) noexcept :
         clk_(clock),
@@ -173,7 +179,7 @@ template<typename TClockGet, period::value TWindow, period::value TInterval, typ
 template<bool TWrite>
 TValue ewma<TClockGet, TWindow, TInterval, TValue>::tick(const clock_point &at) noexcept
 {
-    int missed_intervals;
+    long double missed_intervals;
     clock_point last;
 
     last = last_;
@@ -212,24 +218,11 @@ TValue ewma<TClockGet, TWindow, TInterval, TValue>::tick(const clock_point &at)
     auto rate = nrate + (alpha_ * (pending - nrate));
 
     // figure out how many intervals we've missed
-    missed_intervals = ((at - last) / period(TInterval)) - 1;
+    missed_intervals = std::floor((at - last) / period(TInterval)) - 1;
     if (missed_intervals > 0)
     {
-        // we missed some intervals - we'll average in zeros
-        if ((at - last) > period(TWindow) && TWindow > TInterval)
-        {
-            constexpr auto intervals_per_window = TWindow / TInterval;
-            period::value missed_windows = missed_intervals / intervals_per_window;
-            rate = pow(rate, 1/pow(missed_windows, 2));
-
-            // figure out the missed intervals now
-            missed_intervals -= (missed_windows * intervals_per_window);
-        }
-
-        // this is the fastest way to do this - the alternative is a standard repeated integral
-        // but this is faster
-        for (int i = 0; i < missed_intervals; i++)
-            rate = rate + (alpha_ * -rate);
+        // we missed some intervals - averaging in n zeros is the same as rate * (1 - alpha)^n
+        rate = rate * std::exp(missed_intervals * log_decay_);
     }
 
     if (std::isnan(rate) || std::isinf(rate))
@@ -272,13 +265,26 @@ struct steady_clock_point
     }
 };
 
+/**
+ * \brief The TClockGet that metrics use unless they're given one
+ *
+ * Define CXXMETRICS_COARSE_CLOCK to have every metric use the coarse clock by default
+ */
+#ifdef CXXMETRICS_COARSE_CLOCK
+using default_clock_point = coarse_clock_point;
+#else
+using default_clock_point = steady_clock_point;
+#endif
+
 /**
  * \brief An exponential weighted moving average metric
+ *
+ * \tparam TClockGet the 'functor' that gets the current time
  */
-template<period::value TWindow, period::value TInterval = time::seconds(1), typename TValue = double>
-class ewma : public metric<ewma<TWindow, TInterval, TValue>>
+template<period::value TWindow, period::value TInterval = time::seconds(1), typename TValue = double, typename TClockGet = default_clock_point>
+class ewma : public metric<ewma<TWindow, TInterval, TValue, TClockGet>>
 {
-    internal::ewma<steady_clock_point, TWindow, TInterval, TValue> ewma_;
+    internal::ewma<TClockGet, TWindow, TInterval, TValue> ewma_;
 public:
     /**
      * \brief Construct an exponential weighted moving average
@@ -300,6 +306,7 @@ public:
     typename std::enable_if<std::is_arithmetic<TMark>::value, void>::type mark(TMark value) noexcept
     {
         ewma_.mark(value);
+        this->changed();
     }
 
     /**
@@ -329,7 +336,7 @@ public:
      * \return a reference to the ewma
      */
     template<typename TMark>
-    typename std::enable_if<std::is_arithmetic<TMark>::value, ewma<TWindow, TInterval, TValue>>::type&
+    typename std::enable_if<std::is_arithmetic<TMark>::value, ewma<TWindow, TInterval, TValue, TClockGet>>::type&
     operator+=(typename std::enable_if<std::is_arithmetic<TMark>::value, TMark>::type value) noexcept
     {
         mark(value);
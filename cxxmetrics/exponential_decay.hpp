@@ -1,9 +1,247 @@
 #ifndef CXXMETRICS_EXPONENTIAL_DECAY_HPP
 #define CXXMETRICS_EXPONENTIAL_DECAY_HPP
 
+#include "ewma.hpp"
+#include "snapshots.hpp"
+#include "internal/thread_random.hpp"
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
 namespace cxxmetrics
 {
 
+namespace internal
+{
+
+/**
+ * \brief Get the number of seconds in a clock difference
+ */
+template<typename TRep, typename TPeriod>
+inline double clock_seconds(const std::chrono::duration<TRep, TPeriod>& diff) noexcept
+{
+    return std::chrono::duration<double>(diff).count();
+}
+
+/**
+ * \brief Get the number of seconds in a clock difference from a clock that isn't a std::chrono clock
+ *
+ * Like periods, these clocks are taken to be in microseconds
+ */
+template<typename TDiff>
+inline double clock_seconds(const TDiff& diff) noexcept
+{
+    return diff / 1000000.0;
+}
+
+}
+
+/**
+ * \brief A reservoir that samples values with a bias towards recent activity
+ *
+ * This uses forward decay priority sampling (Cormode et al.): every value gets the priority
+ * exp(alpha * (t - landmark)) / u for a random u, and the TSize values with the highest priorities are kept.
+ * The priorities grow with time so the landmark is moved forward every TRescale, scaling the kept priorities down.
+ *
+ * Values whose priority can't make it into a full reservoir are rejected without taking a lock, everything else
+ * is a heap update under a mutex.
+ *
+ * \tparam TElem the type of elements in the reservoir
+ * \tparam TSize the number of values to keep in the reservoir
+ * \tparam TRescale how often to move the landmark forward
+ * \tparam TClockGet the 'functor' (the C++ kind, not an actual functor) that gets the current time
+ */
+template<typename TElem, std::size_t TSize = 1028, period::value TRescale = time::hours(1), typename TClockGet = default_clock_point>
+class exponential_decay_reservoir
+{
+public:
+    using value_type = TElem;
+    using clock_point = typename internal::clock_traits<TClockGet>::clock_point;
+
+private:
+    struct sample
+    {
+        double priority;
+        TElem value;
+
+        bool operator>(const sample& other) const noexcept
+        {
+            return priority > other.priority;
+        }
+    };
+
+    TClockGet clock_;
+    clock_point start_;
+    double alpha_;
+
+    mutable std::mutex lock_;
+    // a min heap on the priorities so the next sample to be replaced is at the front
+    std::vector<sample> samples_;
+    // the landmark in seconds since start_
+    std::atomic<double> landmark_;
+    // the lowest priority that's kept once the reservoir is full
+    std::atomic<double> threshold_;
+
+    static constexpr double rescale_seconds()
+    {
+        return TRescale / 1000000.0;
+    }
+
+    double priority(double at, double landmark, double u) const noexcept
+    {
+        return std::exp(alpha_ * (at - landmark)) / u;
+    }
+
+    void rescale(double at) noexcept;
+
+public:
+    /**
+     * \brief Construct an exponentially decaying reservoir
+     *
+     * \param alpha how strongly the reservoir is biased towards recent values. The default keeps about 5 minutes of values significant
+     * \param clock the clock object to use for deriving timestamps
+     */
+    explicit exponential_decay_reservoir(double alpha = 0.015, const TClockGet &clock = TClockGet()) noexcept;
+
+    /**
+     * \brief Copy constructor
+     */
+    exponential_decay_reservoir(const exponential_decay_reservoir &other) noexcept;
+    ~exponential_decay_reservoir() = default;
+
+    /**
+     * \brief Assignment operator
+     */
+    exponential_decay_reservoir &operator=(const exponential_decay_reservoir &other) noexcept;
+
+    /**
+     * \brief Update the reservoir with a value
+     */
+    void update(const TElem &v) noexcept;
+
+    /**
+     * \brief Get a snapshot of the reservoir
+     *
+     * \return a reservoir snapshot
+     */
+    basic_reservoir_snapshot<TElem> snapshot() const noexcept;
+};
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::exponential_decay_reservoir(double alpha, const TClockGet &clock) noexcept :
+        clock_(clock),
+        start_(clock()),
+        alpha_(alpha),
+        landmark_(0),
+        threshold_(0)
+{
+    samples_.reserve(TSize);
+}
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::exponential_decay_reservoir(const exponential_decay_reservoir &other) noexcept :
+        clock_(other.clock_),
+        start_(other.start_),
+        alpha_(other.alpha_),
+        landmark_(0),
+        threshold_(0)
+{
+    std::lock_guard<std::mutex> lock(other.lock_);
+    samples_ = other.samples_;
+    landmark_.store(other.landmark_.load());
+    threshold_.store(other.threshold_.load());
+}
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet> &
+exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::operator=(const exponential_decay_reservoir &other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    std::unique_lock<std::mutex> mine(lock_, std::defer_lock);
+    std::unique_lock<std::mutex> theirs(other.lock_, std::defer_lock);
+    std::lock(mine, theirs);
+
+    clock_ = other.clock_;
+    start_ = other.start_;
+    alpha_ = other.alpha_;
+    samples_ = other.samples_;
+    landmark_.store(other.landmark_.load());
+    threshold_.store(other.threshold_.load());
+
+    return *this;
+}
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+void exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::rescale(double at) noexcept
+{
+    // called with the lock held
+    auto landmark = landmark_.load(std::memory_order_relaxed);
+    auto factor = std::exp(-alpha_ * (at - landmark));
+
+    // scaling every priority by the same factor keeps the heap ordered
+    for (auto& s : samples_)
+        s.priority *= factor;
+
+    // the landmark goes last: an update that sees the new landmark then sees the rescaled threshold, and one that
+    // sees the old landmark with the new, smaller threshold just falls through to taking the lock
+    if (samples_.size() >= TSize)
+        threshold_.store(samples_.front().priority, std::memory_order_release);
+    landmark_.store(at, std::memory_order_release);
+}
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+void exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::update(const TElem &v) noexcept
+{
+    auto at = internal::clock_seconds(clock_() - start_);
+    auto u = internal::thread_random_unit();
+    auto landmark = landmark_.load(std::memory_order_acquire);
+
+    // the fast path: a full reservoir wouldn't keep this value anyway
+    auto threshold = threshold_.load(std::memory_order_acquire);
+    if (threshold > 0 && at - landmark < rescale_seconds() && priority(at, landmark, u) <= threshold)
+        return;
+
+    std::lock_guard<std::mutex> lock(lock_);
+    if (at - landmark_.load(std::memory_order_relaxed) >= rescale_seconds())
+        rescale(at);
+
+    auto p = priority(at, landmark_.load(std::memory_order_relaxed), u);
+    if (samples_.size() < TSize)
+    {
+        samples_.push_back(sample{p, v});
+        std::push_heap(samples_.begin(), samples_.end(), std::greater<sample>());
+    }
+    else if (p > samples_.front().priority)
+    {
+        std::pop_heap(samples_.begin(), samples_.end(), std::greater<sample>());
+        samples_.back() = sample{p, v};
+        std::push_heap(samples_.begin(), samples_.end(), std::greater<sample>());
+    }
+    else
+        return;
+
+    if (samples_.size() >= TSize)
+        threshold_.store(samples_.front().priority, std::memory_order_release);
+}
+
+template<typename TElem, std::size_t TSize, period::value TRescale, typename TClockGet>
+basic_reservoir_snapshot<TElem> exponential_decay_reservoir<TElem, TSize, TRescale, TClockGet>::snapshot() const noexcept
+{
+    std::vector<TElem> values;
+    values.reserve(TSize);
+
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        for (const auto& s : samples_)
+            values.push_back(s.value);
+    }
+
+    return basic_reservoir_snapshot<TElem>(values.data(), values.size());
+}
+
 }
 
 #endif //CXXMETRICS_EXPONENTIAL_DECAY_HPP
@@ -2,6 +2,7 @@
 #define CXXMETRICS_GAUGE_HPP
 
 #include "metric.hpp"
+#include <limits>
 #include <type_traits>
 
 namespace cxxmetrics
@@ -226,10 +227,17 @@ public:
     gauge& operator=(const TGaugeType& value) noexcept
     {
         gauges::primitive_gauge<TGaugeType>::operator=(value);
+        this->changed();
         return *this;
     }
     gauge& operator=(const gauge& other) = default;
     gauge& operator=(gauge&& mv) = default;
+
+    void set(TGaugeType value) noexcept
+    {
+        gauges::primitive_gauge<TGaugeType>::set(value);
+        this->changed();
+    }
 };
 
 template<typename T, gauges::gauge_aggregation_type TAggregation>
@@ -248,6 +256,14 @@ public:
 
     gauge& operator=(const gauge& other) = default;
     gauge& operator=(gauge&& mv) = default;
+
+    /**
+     * \brief The function can return something different at any time, so the gauge always counts as changed
+     */
+    std::uint64_t changed_generation() const noexcept override
+    {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
 };
 
 template<typename TGaugeType, gauges::gauge_aggregation_type TAggregation>
@@ -261,6 +277,14 @@ public:
     ~gauge() = default;
 
     gauge& operator=(const gauge& other) = default;
+
+    /**
+     * \brief The referenced value can change without the gauge knowing, so the gauge always counts as changed
+     */
+    std::uint64_t changed_generation() const noexcept override
+    {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
 };
 
 template<typename TGaugeType, gauges::gauge_aggregation_type TAggregation>
@@ -274,6 +298,14 @@ public:
     ~gauge() = default;
 
     gauge& operator=(const gauge& other) = default;
+
+    /**
+     * \brief The referenced value can change without the gauge knowing, so the gauge always counts as changed
+     */
+    std::uint64_t changed_generation() const noexcept override
+    {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
 };
 
 namespace internal
@@ -0,0 +1,552 @@
+#ifndef CXXMETRICS_HDR_RESERVOIR_HPP
+#define CXXMETRICS_HDR_RESERVOIR_HPP
+
+#include "snapshots.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+constexpr int64_t hdr_pow10(int digits)
+{
+    return digits == 0 ? 1 : 10 * hdr_pow10(digits - 1);
+}
+
+constexpr int hdr_log2_ceil(int64_t value)
+{
+    int result = 0;
+    while ((static_cast<int64_t>(1) << result) < value)
+        ++result;
+    return result;
+}
+
+constexpr int hdr_log2_floor(int64_t value)
+{
+    int result = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+constexpr int hdr_bucket_count(int64_t highest, int64_t sub_bucket_count, int unit_magnitude)
+{
+    int64_t smallest_untrackable = sub_bucket_count << unit_magnitude;
+    int buckets = 1;
+    while (smallest_untrackable <= highest)
+    {
+        if (smallest_untrackable > std::numeric_limits<int64_t>::max() / 2)
+            return buckets + 1;
+        smallest_untrackable <<= 1;
+        ++buckets;
+    }
+
+    return buckets;
+}
+
+/**
+ * \brief Get the number of bits needed to represent a non-zero value
+ */
+inline int hdr_bit_length(uint64_t value) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 64 - __builtin_clzll(value);
+#else
+    int result = 0;
+    while (value)
+    {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+#endif
+}
+
+/**
+ * \brief The log-linear bucket layout of an HDR histogram
+ *
+ * Values are split into buckets by their power of 2 and each bucket is split linearly into enough sub buckets
+ * to keep the requested number of significant digits. This is the same layout HdrHistogram uses.
+ */
+template<int64_t TLowest, int64_t THighest, int TSignificantDigits>
+struct hdr_layout
+{
+    static_assert(TLowest >= 1, "The lowest discernible value of an hdr reservoir must be at least 1");
+    static_assert(THighest >= 2 * TLowest, "The highest trackable value of an hdr reservoir must be at least twice the lowest");
+    static_assert(TSignificantDigits >= 1 && TSignificantDigits <= 5, "An hdr reservoir can track between 1 and 5 significant digits");
+
+    static constexpr int sub_bucket_count_magnitude = hdr_log2_ceil(2 * hdr_pow10(TSignificantDigits));
+    static constexpr int sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    static constexpr int64_t sub_bucket_count = static_cast<int64_t>(1) << sub_bucket_count_magnitude;
+    static constexpr int64_t sub_bucket_half_count = sub_bucket_count / 2;
+    static constexpr int unit_magnitude = hdr_log2_floor(TLowest);
+    static constexpr int64_t sub_bucket_mask = (sub_bucket_count - 1) << unit_magnitude;
+    static constexpr int bucket_count = hdr_bucket_count(THighest, sub_bucket_count, unit_magnitude);
+    static constexpr std::size_t counts_length = (bucket_count + 1) * sub_bucket_half_count;
+
+    static std::size_t index_of(int64_t value) noexcept
+    {
+        if (value < 0)
+            value = 0;
+        else if (value > THighest)
+            value = THighest;
+
+        int pow2ceiling = hdr_bit_length(static_cast<uint64_t>(value | sub_bucket_mask));
+        int bucket_index = pow2ceiling - unit_magnitude - (sub_bucket_half_count_magnitude + 1);
+        int64_t sub_bucket_index = value >> (bucket_index + unit_magnitude);
+
+        return static_cast<std::size_t>((static_cast<int64_t>(bucket_index + 1) << sub_bucket_half_count_magnitude) + (sub_bucket_index - sub_bucket_half_count));
+    }
+
+    static int64_t lowest_equivalent(std::size_t index) noexcept
+    {
+        int bucket_index;
+        return lowest_equivalent(index, bucket_index);
+    }
+
+    static int64_t highest_equivalent(std::size_t index) noexcept
+    {
+        int bucket_index;
+        auto lowest = lowest_equivalent(index, bucket_index);
+        return lowest + (static_cast<int64_t>(1) << (unit_magnitude + bucket_index)) - 1;
+    }
+
+    static int64_t median_equivalent(std::size_t index) noexcept
+    {
+        int bucket_index;
+        auto lowest = lowest_equivalent(index, bucket_index);
+        return lowest + ((static_cast<int64_t>(1) << (unit_magnitude + bucket_index)) >> 1);
+    }
+
+private:
+    static int64_t lowest_equivalent(std::size_t index, int& bucket_index) noexcept
+    {
+        bucket_index = static_cast<int>(index >> sub_bucket_half_count_magnitude) - 1;
+        int64_t sub_bucket_index = static_cast<int64_t>(index & (sub_bucket_half_count - 1)) + sub_bucket_half_count;
+        if (bucket_index < 0)
+        {
+            sub_bucket_index -= sub_bucket_half_count;
+            bucket_index = 0;
+        }
+
+        return sub_bucket_index << (bucket_index + unit_magnitude);
+    }
+};
+
+/**
+ * \brief Converts reservoir elements to and from the integral units that an hdr reservoir tracks
+ */
+template<typename TElem>
+struct hdr_units
+{
+    static int64_t to_units(const TElem& value) noexcept
+    {
+        return static_cast<int64_t>(value);
+    }
+
+    static TElem from_units(int64_t value) noexcept
+    {
+        return static_cast<TElem>(value);
+    }
+};
+
+template<typename TRep, typename TPeriod>
+struct hdr_units<std::chrono::duration<TRep, TPeriod>>
+{
+    static int64_t to_units(const std::chrono::duration<TRep, TPeriod>& value) noexcept
+    {
+        return static_cast<int64_t>(value.count());
+    }
+
+    static std::chrono::duration<TRep, TPeriod> from_units(int64_t value) noexcept
+    {
+        return std::chrono::duration<TRep, TPeriod>(static_cast<TRep>(value));
+    }
+};
+
+template<typename TSnapshot>
+class hdr_snapshot_data;
+
+}
+
+/**
+ * \brief A snapshot of the bucket counts in an hdr_reservoir
+ *
+ * Only the buckets that have values are kept. Merging snapshots of the same reservoir type sums their counts,
+ * so merging doesn't lose any precision.
+ */
+template<typename TElem, int64_t TLowest, int64_t THighest, int TSignificantDigits>
+class hdr_reservoir_snapshot
+{
+    using layout = internal::hdr_layout<TLowest, THighest, TSignificantDigits>;
+    using units = internal::hdr_units<TElem>;
+
+    struct bucket
+    {
+        std::size_t index;
+        uint64_t count;
+    };
+
+    std::vector<bucket> buckets_;
+    uint64_t total_;
+
+    metric_value at_rank(uint64_t rank) const noexcept
+    {
+        uint64_t seen = 0;
+        for (const auto& b : buckets_)
+        {
+            seen += b.count;
+            if (rank < seen)
+                return metric_value(units::from_units(layout::median_equivalent(b.index)));
+        }
+
+        return max();
+    }
+
+public:
+    using value_type = TElem;
+
+    /**
+     * \brief Construct a snapshot from the reservoir's counts
+     *
+     * \param counts the counts of each bucket in the reservoir
+     */
+    explicit hdr_reservoir_snapshot(const std::atomic<uint64_t>* counts) :
+            total_(0)
+    {
+        for (std::size_t i = 0; i < layout::counts_length; i++)
+        {
+            auto c = counts[i].load(std::memory_order_relaxed);
+            if (!c)
+                continue;
+
+            buckets_.push_back(bucket{i, c});
+            total_ += c;
+        }
+    }
+
+    hdr_reservoir_snapshot(hdr_reservoir_snapshot&& other) noexcept = default;
+    hdr_reservoir_snapshot& operator=(hdr_reservoir_snapshot&& other) noexcept = default;
+
+    hdr_reservoir_snapshot(const hdr_reservoir_snapshot& c) = delete;
+    hdr_reservoir_snapshot& operator=(const hdr_reservoir_snapshot& c) = delete;
+
+    /**
+     * \brief Get the value at a specified quantile
+     *
+     * \tparam TQuantile the quantile for which to get the value. Must be between 0 and 100. For example 99.999_p
+     *
+     * \return the value at the specified quantile
+     */
+    template<quantile::value TQuantile>
+    metric_value value() const noexcept
+    {
+        constexpr auto q = ((long double)quantile(TQuantile))/100.0;
+        static_assert(q >= 0 && q <= 1, "The provided quantile value is invalid. Must be between 0 and 1");
+
+        return value(q);
+    }
+
+    /**
+     * \brief Get the value at a quantile that's only known at runtime
+     *
+     * Quantiles are interpolated between ranks the same way they are for a basic_reservoir_snapshot
+     *
+     * \param q the quantile between 0 and 1
+     *
+     * \return the value at the specified quantile
+     */
+    metric_value value(long double q) const noexcept
+    {
+        if (total_ < 1)
+            return metric_value(0);
+
+        auto pos = q * (total_ + 1);
+        auto index = static_cast<int64_t>(pos);
+
+        if (index < 1)
+            return min();
+        if (static_cast<uint64_t>(index) >= total_)
+            return max();
+
+        auto lower = at_rank(index - 1);
+        return lower + metric_value((pos - index) * static_cast<long double>(at_rank(index) - lower));
+    }
+
+    /**
+     * \brief Get the mean value in the snapshot
+     *
+     * \return the snapshot mean
+     */
+    metric_value mean() const noexcept
+    {
+        if (total_ < 1)
+            return metric_value(0);
+        if (total_ == 1)
+            return at_rank(0);
+
+        long double sum = 0;
+        for (const auto& b : buckets_)
+            sum += static_cast<long double>(layout::median_equivalent(b.index)) * b.count;
+
+        return metric_value(sum / total_);
+    }
+
+    /**
+     * \brief Get the lowest value equivalent to the smallest value in the snapshot
+     *
+     * \return The minimum value in the snapshot
+     */
+    metric_value min() const noexcept
+    {
+        if (buckets_.empty())
+            return metric_value(std::numeric_limits<int64_t>::min());
+        return metric_value(units::from_units(layout::lowest_equivalent(buckets_.front().index)));
+    }
+
+    /**
+     * \brief Get the highest value equivalent to the largest value in the snapshot
+     *
+     * \return The maximum value in the snapshot
+     */
+    metric_value max() const noexcept
+    {
+        if (buckets_.empty())
+            return metric_value(std::numeric_limits<int64_t>::max());
+        return metric_value(units::from_units(layout::highest_equivalent(buckets_.back().index)));
+    }
+
+    /**
+     * \brief Get the number of values recorded in the snapshot
+     *
+     * \return the number of values recorded in the snapshot
+     */
+    std::size_t size() const noexcept
+    {
+        return static_cast<std::size_t>(total_);
+    }
+
+    /**
+     * \brief Merge the counts from another snapshot into this one
+     *
+     * \param other the snapshot to merge in
+     */
+    void merge(const hdr_reservoir_snapshot& other)
+    {
+        std::vector<bucket> merged;
+        merged.reserve(buckets_.size() + other.buckets_.size());
+
+        auto a = buckets_.begin();
+        auto b = other.buckets_.begin();
+        while (a != buckets_.end() || b != other.buckets_.end())
+        {
+            if (b == other.buckets_.end() || (a != buckets_.end() && a->index < b->index))
+                merged.push_back(*a++);
+            else if (a == buckets_.end() || b->index < a->index)
+                merged.push_back(*b++);
+            else
+            {
+                merged.push_back(bucket{a->index, a->count + b->count});
+                ++a;
+                ++b;
+            }
+        }
+
+        buckets_ = std::move(merged);
+        total_ += other.total_;
+    }
+
+    /**
+     * \brief Append a representative sample of the snapshot's values as metric_values
+     *
+     * Each bucket contributes a number of values proportional to its count, up to about max_values in total
+     *
+     * \param values the collection to append to
+     * \param max_values the approximate maximum number of values to append
+     */
+    void append_to(std::vector<metric_value>& values, uint64_t max_values = 1024) const
+    {
+        for (const auto& b : buckets_)
+        {
+            auto count = (total_ <= max_values) ? b.count : (b.count * max_values + total_ / 2) / total_;
+            for (uint64_t i = 0; i < count; i++)
+                values.emplace_back(units::from_units(layout::median_equivalent(b.index)));
+        }
+    }
+
+    /**
+     * \brief Convert the snapshot into a type erased reservoir_snapshot
+     */
+    operator reservoir_snapshot() &&
+    {
+        return reservoir_snapshot(std::unique_ptr<internal::reservoir_snapshot_data>(
+                new internal::hdr_snapshot_data<hdr_reservoir_snapshot>(std::move(*this))));
+    }
+};
+
+namespace internal
+{
+
+template<typename TSnapshot>
+class hdr_snapshot_data : public reservoir_snapshot_data
+{
+    TSnapshot snapshot_;
+public:
+    hdr_snapshot_data(TSnapshot&& snapshot) noexcept :
+            snapshot_(std::move(snapshot))
+    { }
+
+    metric_value value(long double q) const noexcept override
+    {
+        return snapshot_.value(q);
+    }
+
+    metric_value mean() const noexcept override
+    {
+        return snapshot_.mean();
+    }
+
+    metric_value min() const noexcept override
+    {
+        return snapshot_.min();
+    }
+
+    metric_value max() const noexcept override
+    {
+        return snapshot_.max();
+    }
+
+    std::size_t size() const noexcept override
+    {
+        return snapshot_.size();
+    }
+
+    void select(const long double* quantiles, std::size_t count) const noexcept override
+    { }
+
+    void append_to(std::vector<metric_value>& values) const override
+    {
+        snapshot_.append_to(values);
+    }
+
+    bool merge_same(const reservoir_snapshot_data& other) override
+    {
+        auto same = dynamic_cast<const hdr_snapshot_data*>(&other);
+        if (!same)
+            return false;
+
+        snapshot_.merge(same->snapshot_);
+        return true;
+    }
+};
+
+}
+
+/**
+ * \brief A reservoir that counts every value into log-linear buckets, like HdrHistogram
+ *
+ * Unlike the sampling reservoirs, every value is recorded so the tail quantiles are accurate to the requested
+ * number of significant digits. An update is just finding the bucket index and a relaxed atomic increment.
+ * Values are tracked in integral units of TElem (the count for durations), and values outside of the
+ * trackable range are clamped into it.
+ *
+ * The counts take (bucket count + 1) * 2^(log2(2 * 10^TSignificantDigits) - 1) 64 bit counters, which is about
+ * 270KB for the defaults, and every snapshot reads all of them (about 33,000 for the defaults). Each tagged
+ * permutation of a registered histogram has a reservoir of its own, so histograms with a lot of permutations
+ * should narrow the range or keep fewer significant digits: 2 digits takes about 37KB over the same range.
+ *
+ * \tparam TElem the type of elements in the reservoir
+ * \tparam TLowest the lowest value that can be discerned from 0
+ * \tparam THighest the highest value that can be tracked
+ * \tparam TSignificantDigits the number of significant digits to keep for each value
+ */
+template<typename TElem, int64_t TLowest = 1, int64_t THighest = 3600000000000ll, int TSignificantDigits = 3>
+class hdr_reservoir
+{
+    using layout = internal::hdr_layout<TLowest, THighest, TSignificantDigits>;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+
+    void copy_counts(const hdr_reservoir& other) noexcept
+    {
+        for (std::size_t i = 0; i < layout::counts_length; i++)
+            counts_[i].store(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+public:
+    using value_type = TElem;
+    using snapshot_type = hdr_reservoir_snapshot<TElem, TLowest, THighest, TSignificantDigits>;
+
+    /**
+     * \brief Construct an hdr reservoir
+     */
+    hdr_reservoir();
+
+    /**
+     * \brief Copy constructor
+     */
+    hdr_reservoir(const hdr_reservoir& other);
+
+    // there's deliberately no move constructor, since it would leave the moved from reservoir without any counts
+    // to update, so moving a reservoir copies it
+    ~hdr_reservoir() = default;
+
+    /**
+     * \brief Assignment operator
+     */
+    hdr_reservoir& operator=(const hdr_reservoir& other) noexcept;
+
+    /**
+     * \brief Update the hdr reservoir with a value
+     */
+    void update(const TElem& value) noexcept
+    {
+        counts_[layout::index_of(internal::hdr_units<TElem>::to_units(value))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Get a snapshot of the reservoir
+     *
+     * \return a snapshot of the bucket counts
+     */
+    snapshot_type snapshot() const
+    {
+        return snapshot_type(counts_.get());
+    }
+};
+
+template<typename TElem, int64_t TLowest, int64_t THighest, int TSignificantDigits>
+hdr_reservoir<TElem, TLowest, THighest, TSignificantDigits>::hdr_reservoir() :
+        counts_(new std::atomic<uint64_t>[layout::counts_length])
+{
+    for (std::size_t i = 0; i < layout::counts_length; i++)
+        counts_[i].store(0, std::memory_order_relaxed);
+}
+
+template<typename TElem, int64_t TLowest, int64_t THighest, int TSignificantDigits>
+hdr_reservoir<TElem, TLowest, THighest, TSignificantDigits>::hdr_reservoir(const hdr_reservoir& other) :
+        counts_(new std::atomic<uint64_t>[layout::counts_length])
+{
+    copy_counts(other);
+}
+
+template<typename TElem, int64_t TLowest, int64_t THighest, int TSignificantDigits>
+hdr_reservoir<TElem, TLowest, THighest, TSignificantDigits>& hdr_reservoir<TElem, TLowest, THighest, TSignificantDigits>::operator=(const hdr_reservoir& other) noexcept
+{
+    if (this != &other)
+        copy_counts(other);
+    return *this;
+}
+
+}
+
+#endif //CXXMETRICS_HDR_RESERVOIR_HPP
@@ -42,6 +42,7 @@ public:
     {
         ++count_;
         reservoir_.update(value);
+        this->changed();
     }
 
     /**
@@ -59,7 +60,7 @@ public:
      *
      * \return a snapshot of the histogram
      */
-    histogram_snapshot snapshot() const noexcept
+    histogram_snapshot snapshot() const noexcept(noexcept(std::declval<const TReservoir&>().snapshot()))
     {
         auto c = count_.value();
         return histogram_snapshot(reservoir_.snapshot(), c);
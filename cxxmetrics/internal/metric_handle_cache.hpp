@@ -0,0 +1,124 @@
+#ifndef CXXMETRICS_METRIC_HANDLE_CACHE_HPP
+#define CXXMETRICS_METRIC_HANDLE_CACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "../metric.hpp"
+#include "../metric_path.hpp"
+#include "../tag_collection.hpp"
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief A small per-thread cache of the metrics a thread has looked up in registries
+ *
+ * The cache is direct mapped: each path, tag set, and registry lands in exactly one slot and replaces whatever was
+ * there. Entries only hold weak references so the cache never keeps a permutation from being dropped, and they
+ * remember the registry's eviction epoch so anything cached before the registry dropped permutations is looked
+ * up again rather than handing out a metric the registry no longer has.
+ *
+ * Finding a metric in the cache doesn't tell the registry the permutation is still in use, so entries also go
+ * stale after a while, and the next lookup goes through the registry and marks the permutation as used again.
+ */
+class metric_handle_cache
+{
+    static constexpr std::size_t slots = 64;
+
+    struct entry
+    {
+        std::uint64_t registry;
+        std::uint64_t epoch;
+        std::chrono::steady_clock::rep stale_at;
+        const void* type;
+        metric_path path;
+        tag_collection tags;
+        std::weak_ptr<metric> handle;
+
+        entry() :
+                registry(0),
+                epoch(0),
+                stale_at(0),
+                type(nullptr),
+                path("")
+        { }
+    };
+
+    entry entries_[slots];
+
+    static std::size_t slot(std::uint64_t registry, const metric_path& path, const tag_collection& tags) noexcept
+    {
+        return ((path.hash() * 31) ^ tags.hash() ^ registry) & (slots - 1);
+    }
+
+public:
+    /**
+     * \brief Get the calling thread's cache
+     */
+    static metric_handle_cache& local()
+    {
+        static thread_local metric_handle_cache cache;
+        return cache;
+    }
+
+    /**
+     * \brief Get a registry id that's never been used by another registry, so caches can't confuse two registries
+     * that happened to live at the same address
+     */
+    static std::uint64_t next_registry_id() noexcept
+    {
+        static std::atomic<std::uint64_t> next(1);
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Find a metric in the cache
+     *
+     * \param registry the id of the registry the metric was looked up in
+     * \param epoch the registry's current eviction epoch
+     * \param type the identity of the metric's type
+     * \param path the path of the metric
+     * \param tags the tags of the metric
+     * \param now the current coarse clock time
+     *
+     * \return the cached metric or nullptr if it isn't cached or the cached entry is stale
+     */
+    std::shared_ptr<metric> find(std::uint64_t registry, std::uint64_t epoch, const void* type, const metric_path& path, const tag_collection& tags,
+            std::chrono::steady_clock::rep now) const
+    {
+        auto& e = entries_[slot(registry, path, tags)];
+        if (e.registry != registry || e.epoch != epoch || now >= e.stale_at || e.type != type || e.path != path || e.tags != tags)
+            return nullptr;
+
+        return e.handle.lock();
+    }
+
+    /**
+     * \brief Put a metric into the cache, replacing whatever was in its slot
+     *
+     * \param stale_at the coarse clock time after which the entry has to be looked up in the registry again
+     */
+    void store(std::uint64_t registry, std::uint64_t epoch, const void* type, const metric_path& path, const tag_collection& tags,
+            const std::shared_ptr<metric>& handle, std::chrono::steady_clock::rep stale_at)
+    {
+        auto& e = entries_[slot(registry, path, tags)];
+        e.registry = registry;
+        e.epoch = epoch;
+        e.stale_at = stale_at;
+        e.type = type;
+        e.path = path;
+        e.tags = tags;
+        e.handle = handle;
+    }
+};
+
+}
+
+}
+
+#endif //CXXMETRICS_METRIC_HANDLE_CACHE_HPP
@@ -0,0 +1,595 @@
+#ifndef CXXMETRICS_READ_MOSTLY_MAP_HPP
+#define CXXMETRICS_READ_MOSTLY_MAP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "thread_stripe.hpp"
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief Keeps track of the threads reading read_mostly_maps so that memory removed from a map can be freed safely
+ *
+ * A reader counts itself in on its thread's stripe when it starts and out when it's done. The counts are split
+ * in two phases: waiting for readers flips the phase new readers count themselves into and waits for everyone in
+ * the old phase to finish, then does it again for the other phase. After that no reader that could have seen
+ * something before it was removed is still looking at it.
+ */
+class read_mostly_readers
+{
+    static constexpr std::size_t stripes = 16;
+
+    struct alignas(cache_line_size) stripe
+    {
+        std::atomic<std::uint64_t> entered[2];
+        std::atomic<std::uint64_t> exited[2];
+    };
+
+    stripe stripes_[stripes];
+    std::atomic<unsigned> phase_;
+    std::mutex lock_;
+
+    void drain(unsigned phase) noexcept;
+
+public:
+    read_mostly_readers() noexcept;
+    read_mostly_readers(const read_mostly_readers&) = delete;
+    read_mostly_readers& operator=(const read_mostly_readers&) = delete;
+
+    static read_mostly_readers& instance()
+    {
+        static read_mostly_readers readers;
+        return readers;
+    }
+
+    unsigned enter() noexcept
+    {
+        auto phase = phase_.load(std::memory_order_relaxed) & 1;
+        stripes_[thread_stripe() % stripes].entered[phase].fetch_add(1, std::memory_order_seq_cst);
+        return phase;
+    }
+
+    void exit(unsigned phase) noexcept
+    {
+        stripes_[thread_stripe() % stripes].exited[phase].fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * \brief Wait for every reader that started before the call to finish
+     *
+     * \warning Never call this while holding a read_mostly_guard on the same thread, it'll wait forever
+     */
+    void wait() noexcept;
+};
+
+inline read_mostly_readers::read_mostly_readers() noexcept :
+        phase_(0)
+{
+    for (auto& s : stripes_)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            s.entered[i].store(0, std::memory_order_relaxed);
+            s.exited[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline void read_mostly_readers::drain(unsigned phase) noexcept
+{
+    for (auto& s : stripes_)
+    {
+        // read the exits first so a reader that comes and goes in between can't make the stripe look empty
+        while (s.exited[phase].load(std::memory_order_seq_cst) != s.entered[phase].load(std::memory_order_seq_cst))
+            std::this_thread::yield();
+    }
+}
+
+inline void read_mostly_readers::wait() noexcept
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (int i = 0; i < 2; i++)
+    {
+        auto old = phase_.load(std::memory_order_relaxed) & 1;
+        phase_.store(old ^ 1, std::memory_order_seq_cst);
+        drain(old);
+    }
+}
+
+/**
+ * \brief Marks the current thread as reading read_mostly_maps until the guard goes out of scope
+ *
+ * Anything found in a map that has entries removed from it is only good while a guard is held.
+ */
+class read_mostly_guard
+{
+    static constexpr unsigned unguarded = ~0u;
+    unsigned phase_;
+public:
+    read_mostly_guard() noexcept :
+            phase_(read_mostly_readers::instance().enter())
+    { }
+
+    /**
+     * \brief Only guard the thread if the maps it's reading might have entries removed from them
+     *
+     * \param needed whether anything might be removed from the maps while the guard is held
+     */
+    explicit read_mostly_guard(bool needed) noexcept :
+            phase_(needed ? read_mostly_readers::instance().enter() : unguarded)
+    { }
+
+    read_mostly_guard(const read_mostly_guard&) = delete;
+    read_mostly_guard& operator=(const read_mostly_guard&) = delete;
+
+    ~read_mostly_guard()
+    {
+        if (phase_ != unguarded)
+            read_mostly_readers::instance().exit(phase_);
+    }
+};
+
+/**
+ * \brief A hash map where finding an existing key never takes a lock
+ *
+ * The map is an open addressed table of pointers to immutable nodes. Each slot keeps the full hash of its node's
+ * key next to the pointer, so readers hash the key once and probe the table with atomic loads, only following a
+ * pointer out of the table when the hash matches. Inserts take a mutex, publish the new node into an empty slot, and grow the table
+ * by publishing a bigger copy. Replaced tables are kept until the map is destroyed so a reader that's still
+ * probing one never touches freed memory, and since they double in size they never add up to more than the
+ * current table.
+ *
+ * A reader probing a table that's just been replaced might miss a key that was inserted into the new one,
+ * so anything that doesn't find its key has to fall back on get_or_add, which looks again under the lock.
+ *
+ * Maps that never remove anything can be read without further ceremony. Once remove_if is used, readers have to
+ * hold a read_mostly_guard while they look things up and for as long as they use what they found, since
+ * removal frees nodes and old tables as soon as the readers that started before it are done.
+ *
+ * \tparam TKey the type of keys in the map
+ * \tparam TValue the type of values in the map
+ * \tparam THash the hash function for the keys
+ * \tparam TEqual the equality comparison for the keys
+ */
+template<typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TEqual = std::equal_to<TKey>>
+class read_mostly_map
+{
+    struct node
+    {
+        std::size_t hash;
+        TKey key;
+        TValue value;
+
+        node(std::size_t h, const TKey& k, TValue&& v) :
+                hash(h),
+                key(k),
+                value(std::move(v))
+        { }
+    };
+
+    struct slot
+    {
+        // written before the node is published, so it's good to read once the node has been seen
+        std::atomic<std::size_t> hash;
+        std::atomic<node*> entry;
+    };
+
+    struct table
+    {
+        std::size_t mask;
+        std::unique_ptr<slot[]> slots;
+
+        explicit table(std::size_t capacity) :
+                mask(capacity - 1),
+                slots(new slot[capacity])
+        {
+            for (std::size_t i = 0; i < capacity; i++)
+            {
+                slots[i].hash.store(0, std::memory_order_relaxed);
+                slots[i].entry.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    static constexpr std::size_t initial_capacity = 16;
+
+    THash hash_;
+    TEqual equal_;
+    std::atomic<table*> table_;
+    std::atomic<std::size_t> size_;
+
+    // everything below is only touched with the lock held
+    std::mutex lock_;
+    std::vector<std::unique_ptr<table>> tables_;
+
+    node* find_node(const table* t, std::size_t hash, const TKey& key) const;
+    void place(table* t, node* n) noexcept;
+    table* grow(std::size_t count);
+
+    template<typename TBuilder>
+    std::pair<const TKey*, TValue*> add_locked(const TKey& key, std::size_t hash, TBuilder&& builder);
+
+public:
+    /**
+     * \brief Adds many keys to a map while holding its lock the whole time
+     *
+     * Reserving room for everything that's about to be added up front means the table is grown at most once
+     * rather than being copied over and over as it fills. Lookups don't wait for the batch, but anything else
+     * adding to the map does.
+     */
+    class batch
+    {
+        read_mostly_map& map_;
+        std::lock_guard<std::mutex> lock_;
+    public:
+        explicit batch(read_mostly_map& map) :
+                map_(map),
+                lock_(map.lock_)
+        { }
+
+        batch(const batch&) = delete;
+        batch& operator=(const batch&) = delete;
+
+        /**
+         * \brief Make room for the specified number of keys on top of the ones already in the map
+         */
+        void reserve(std::size_t count)
+        {
+            map_.grow(map_.size_.load(std::memory_order_relaxed) + count);
+        }
+
+        /**
+         * \brief The same as the map's get_or_add_entry, without taking the lock again
+         */
+        template<typename TBuilder>
+        std::pair<const TKey*, TValue*> get_or_add_entry(const TKey& key, std::size_t hash, TBuilder&& builder)
+        {
+            return map_.add_locked(key, hash, std::forward<TBuilder>(builder));
+        }
+    };
+
+    read_mostly_map();
+    read_mostly_map(const read_mostly_map&) = delete;
+    read_mostly_map& operator=(const read_mostly_map&) = delete;
+    ~read_mostly_map();
+
+    /**
+     * \brief Find the value for a key without taking a lock
+     *
+     * \return the value for the key, or nullptr if it wasn't found
+     */
+    TValue* find(const TKey& key) const;
+
+    /**
+     * \brief Find the value for a key whose hash is already known without taking a lock
+     *
+     * \return the value for the key, or nullptr if it wasn't found
+     */
+    TValue* find(const TKey& key, std::size_t hash) const;
+
+    /**
+     * \brief Find the key and value stored in the map for a key whose hash is already known without taking a lock
+     *
+     * \return the key and the value stored in the map, or a pair of nullptrs if it wasn't found
+     */
+    std::pair<const TKey*, TValue*> find_entry(const TKey& key, std::size_t hash) const;
+
+    /**
+     * \brief Find the value for a key without building the key or taking a lock
+     *
+     * This is for looking keys up by something cheaper to have than the key itself, like a string by its characters.
+     *
+     * \param hash the hash the key being looked for would have
+     * \param matches called with the keys in the map that have the same hash, returning whether one is the key
+     *
+     * \return the value for the key, or nullptr if it wasn't found
+     */
+    template<typename TMatch>
+    TValue* find_matching(std::size_t hash, TMatch&& matches) const;
+
+    /**
+     * \brief Get the value for a key, building and adding it if it doesn't exist yet
+     *
+     * \param key the key to look up
+     * \param builder called with no arguments to build the value if the key isn't in the map
+     *
+     * \return the value for the key
+     */
+    template<typename TBuilder>
+    TValue& get_or_add(const TKey& key, TBuilder&& builder);
+
+    /**
+     * \brief Get the key and value stored in the map for a key, building and adding the value if it doesn't exist yet
+     *
+     * The stored key lives as long as the map, and finding it again by its own address skips comparing keys
+     *
+     * \return the key and the value stored in the map
+     */
+    template<typename TBuilder>
+    std::pair<const TKey*, TValue*> get_or_add_entry(const TKey& key, std::size_t hash, TBuilder&& builder);
+
+    /**
+     * \brief Remove every entry a predicate matches
+     *
+     * This publishes a new table without the removed entries and then waits for the readers that might still see
+     * them before freeing them, so it must not be called while holding a read_mostly_guard.
+     *
+     * \param predicate called with each key and value, returning true for the entries to remove
+     *
+     * \return the number of entries removed
+     */
+    template<typename TPredicate>
+    std::size_t remove_if(TPredicate&& predicate);
+
+    /**
+     * \brief Hash a key the same way the map does
+     */
+    std::size_t hash(const TKey& key) const
+    {
+        return hash_(key);
+    }
+
+    /**
+     * \brief Call a handler with every key and value in the map without taking a lock
+     *
+     * Values added while the handler is running may or may not be visited
+     */
+    template<typename THandler>
+    void each(THandler&& handler) const;
+
+    /**
+     * \brief Check whether any key and value in the map match a predicate, stopping at the first that does
+     *
+     * Like each, this doesn't take a lock, and values added while it's running may or may not be checked
+     */
+    template<typename TPredicate>
+    bool any(TPredicate&& predicate) const;
+
+    /**
+     * \brief Get the number of values in the map
+     */
+    std::size_t size() const noexcept
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+};
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+read_mostly_map<TKey, TValue, THash, TEqual>::read_mostly_map() :
+        size_(0)
+{
+    tables_.emplace_back(new table(initial_capacity));
+    table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+read_mostly_map<TKey, TValue, THash, TEqual>::~read_mostly_map()
+{
+    // every node that hasn't been removed is in the current table
+    auto t = table_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i <= t->mask; i++)
+        delete t->slots[i].entry.load(std::memory_order_relaxed);
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+typename read_mostly_map<TKey, TValue, THash, TEqual>::node*
+read_mostly_map<TKey, TValue, THash, TEqual>::find_node(const table* t, std::size_t hash, const TKey& key) const
+{
+    // tables are never more than half full so there's always an empty slot to stop at
+    for (auto i = hash & t->mask;; i = (i + 1) & t->mask)
+    {
+        auto n = t->slots[i].entry.load(std::memory_order_acquire);
+        if (n == nullptr)
+            return nullptr;
+        // keys handed out by get_or_add_entry compare by address before falling back on equality
+        if (t->slots[i].hash.load(std::memory_order_relaxed) == hash && (&n->key == &key || equal_(n->key, key)))
+            return n;
+    }
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+void read_mostly_map<TKey, TValue, THash, TEqual>::place(table* t, node* n) noexcept
+{
+    auto i = n->hash & t->mask;
+    while (t->slots[i].entry.load(std::memory_order_relaxed) != nullptr)
+        i = (i + 1) & t->mask;
+
+    t->slots[i].hash.store(n->hash, std::memory_order_relaxed);
+    t->slots[i].entry.store(n, std::memory_order_release);
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+TValue* read_mostly_map<TKey, TValue, THash, TEqual>::find(const TKey& key) const
+{
+    auto n = find_node(table_.load(std::memory_order_acquire), hash_(key), key);
+    return n ? &n->value : nullptr;
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+TValue* read_mostly_map<TKey, TValue, THash, TEqual>::find(const TKey& key, std::size_t hash) const
+{
+    auto n = find_node(table_.load(std::memory_order_acquire), hash, key);
+    return n ? &n->value : nullptr;
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+std::pair<const TKey*, TValue*> read_mostly_map<TKey, TValue, THash, TEqual>::find_entry(const TKey& key, std::size_t hash) const
+{
+    auto n = find_node(table_.load(std::memory_order_acquire), hash, key);
+    if (n == nullptr)
+        return std::pair<const TKey*, TValue*>(nullptr, nullptr);
+
+    return std::make_pair(static_cast<const TKey*>(&n->key), &n->value);
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TMatch>
+TValue* read_mostly_map<TKey, TValue, THash, TEqual>::find_matching(std::size_t hash, TMatch&& matches) const
+{
+    auto t = table_.load(std::memory_order_acquire);
+    for (auto i = hash & t->mask;; i = (i + 1) & t->mask)
+    {
+        auto n = t->slots[i].entry.load(std::memory_order_acquire);
+        if (n == nullptr)
+            return nullptr;
+        if (t->slots[i].hash.load(std::memory_order_relaxed) == hash && matches(static_cast<const TKey&>(n->key)))
+            return &n->value;
+    }
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TBuilder>
+TValue& read_mostly_map<TKey, TValue, THash, TEqual>::get_or_add(const TKey& key, TBuilder&& builder)
+{
+    return *get_or_add_entry(key, hash_(key), std::forward<TBuilder>(builder)).second;
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+typename read_mostly_map<TKey, TValue, THash, TEqual>::table*
+read_mostly_map<TKey, TValue, THash, TEqual>::grow(std::size_t count)
+{
+    auto t = table_.load(std::memory_order_relaxed);
+    auto capacity = t->mask + 1;
+    while (count * 2 > capacity)
+        capacity *= 2;
+
+    if (capacity == t->mask + 1)
+        return t;
+
+    std::unique_ptr<table> bigger(new table(capacity));
+    for (std::size_t i = 0; i <= t->mask; i++)
+    {
+        auto moving = t->slots[i].entry.load(std::memory_order_relaxed);
+        if (moving)
+            place(bigger.get(), moving);
+    }
+
+    tables_.emplace_back(std::move(bigger));
+    t = tables_.back().get();
+    table_.store(t, std::memory_order_release);
+
+    return t;
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TBuilder>
+std::pair<const TKey*, TValue*> read_mostly_map<TKey, TValue, THash, TEqual>::get_or_add_entry(const TKey& key, std::size_t hash, TBuilder&& builder)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    return add_locked(key, hash, std::forward<TBuilder>(builder));
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TBuilder>
+std::pair<const TKey*, TValue*> read_mostly_map<TKey, TValue, THash, TEqual>::add_locked(const TKey& key, std::size_t hash, TBuilder&& builder)
+{
+    auto t = table_.load(std::memory_order_relaxed);
+    auto existing = find_node(t, hash, key);
+    if (existing)
+        return std::make_pair(static_cast<const TKey*>(&existing->key), &existing->value);
+
+    std::unique_ptr<node> n(new node(hash, key, builder()));
+    auto size = size_.load(std::memory_order_relaxed) + 1;
+    t = grow(size);
+
+    auto result = n.get();
+    place(t, n.release());
+    size_.store(size, std::memory_order_relaxed);
+
+    return std::make_pair(static_cast<const TKey*>(&result->key), &result->value);
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TPredicate>
+std::size_t read_mostly_map<TKey, TValue, THash, TEqual>::remove_if(TPredicate&& predicate)
+{
+    std::vector<std::unique_ptr<node>> removed;
+    std::vector<std::unique_ptr<table>> retired;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+
+        auto t = table_.load(std::memory_order_relaxed);
+        std::vector<node*> kept;
+        kept.reserve(size_.load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i <= t->mask; i++)
+        {
+            auto n = t->slots[i].entry.load(std::memory_order_relaxed);
+            if (n == nullptr)
+                continue;
+
+            if (predicate(static_cast<const TKey&>(n->key), n->value))
+                removed.emplace_back(n);
+            else
+                kept.push_back(n);
+        }
+
+        if (removed.empty())
+            return 0;
+
+        // the replacement can shrink as long as it stays no more than half full
+        auto capacity = initial_capacity;
+        while (kept.size() * 2 > capacity)
+            capacity *= 2;
+
+        std::unique_ptr<table> replacement(new table(capacity));
+        for (auto n : kept)
+            place(replacement.get(), n);
+
+        retired = std::move(tables_);
+        tables_.clear();
+        tables_.emplace_back(std::move(replacement));
+        table_.store(tables_.back().get(), std::memory_order_release);
+        size_.store(kept.size(), std::memory_order_relaxed);
+    }
+
+    read_mostly_readers::instance().wait();
+
+    // nobody can be looking at the removed nodes or the old tables anymore
+    return removed.size();
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename THandler>
+void read_mostly_map<TKey, TValue, THash, TEqual>::each(THandler&& handler) const
+{
+    auto t = table_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i <= t->mask; i++)
+    {
+        auto n = t->slots[i].entry.load(std::memory_order_acquire);
+        if (n)
+            handler(static_cast<const TKey&>(n->key), n->value);
+    }
+}
+
+template<typename TKey, typename TValue, typename THash, typename TEqual>
+template<typename TPredicate>
+bool read_mostly_map<TKey, TValue, THash, TEqual>::any(TPredicate&& predicate) const
+{
+    auto t = table_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i <= t->mask; i++)
+    {
+        auto n = t->slots[i].entry.load(std::memory_order_acquire);
+        if (n && predicate(static_cast<const TKey&>(n->key), n->value))
+            return true;
+    }
+
+    return false;
+}
+
+}
+
+}
+
+#endif //CXXMETRICS_READ_MOSTLY_MAP_HPP
@@ -0,0 +1,172 @@
+#ifndef CXXMETRICS_SMALL_VECTOR_HPP
+#define CXXMETRICS_SMALL_VECTOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief A vector that keeps up to TInline elements inside itself instead of allocating them
+ *
+ * This only supports what the flat collections in the library need: reserving up front, appending, and iterating.
+ * Elements are only ever copy or move constructed, never assigned, so they can have reference members.
+ *
+ * \tparam T the type of elements in the vector
+ * \tparam TInline the number of elements that fit without allocating
+ */
+template<typename T, std::size_t TInline>
+class small_vector
+{
+    using storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    storage_type inline_[TInline];
+    T* data_;
+    std::size_t size_;
+    std::size_t capacity_;
+
+    bool is_inline() const noexcept
+    {
+        return data_ == reinterpret_cast<const T*>(inline_);
+    }
+
+    void release() noexcept
+    {
+        clear();
+        if (!is_inline())
+            ::operator delete(data_);
+        data_ = reinterpret_cast<T*>(inline_);
+        capacity_ = TInline;
+    }
+
+    void take(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (!other.is_inline())
+        {
+            // take the other vector's allocation
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = reinterpret_cast<T*>(other.inline_);
+            other.size_ = 0;
+            other.capacity_ = TInline;
+            return;
+        }
+
+        for (auto& e : other)
+            emplace_back(std::move(e));
+        other.clear();
+    }
+
+public:
+    small_vector() noexcept :
+            data_(reinterpret_cast<T*>(inline_)),
+            size_(0),
+            capacity_(TInline)
+    { }
+
+    small_vector(const small_vector& other) :
+            small_vector()
+    {
+        reserve(other.size_);
+        for (const auto& e : other)
+            emplace_back(e);
+    }
+
+    small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) :
+            small_vector()
+    {
+        take(std::move(other));
+    }
+
+    ~small_vector()
+    {
+        release();
+    }
+
+    small_vector& operator=(const small_vector& other)
+    {
+        if (this != &other)
+        {
+            release();
+            reserve(other.size_);
+            for (const auto& e : other)
+                emplace_back(e);
+        }
+
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other)
+        {
+            release();
+            take(std::move(other));
+        }
+
+        return *this;
+    }
+
+    /**
+     * \brief Make room for at least the specified number of elements
+     */
+    void reserve(std::size_t capacity)
+    {
+        if (capacity <= capacity_)
+            return;
+
+        auto data = static_cast<T*>(::operator new(sizeof(T) * capacity));
+        for (std::size_t i = 0; i < size_; i++)
+        {
+            new (data + i) T(std::move(data_[i]));
+            data_[i].~T();
+        }
+
+        if (!is_inline())
+            ::operator delete(data_);
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    template<typename... TArgs>
+    T& emplace_back(TArgs&&... args)
+    {
+        if (size_ == capacity_)
+            reserve(capacity_ * 2);
+
+        auto result = new (data_ + size_) T(std::forward<TArgs>(args)...);
+        ++size_;
+        return *result;
+    }
+
+    void clear() noexcept
+    {
+        for (std::size_t i = 0; i < size_; i++)
+            data_[i].~T();
+        size_ = 0;
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    T* begin() noexcept { return data_; }
+    T* end() noexcept { return data_ + size_; }
+    const T* begin() const noexcept { return data_; }
+    const T* end() const noexcept { return data_ + size_; }
+
+    T& operator[](std::size_t index) noexcept { return data_[index]; }
+    const T& operator[](std::size_t index) const noexcept { return data_[index]; }
+};
+
+}
+
+}
+
+#endif //CXXMETRICS_SMALL_VECTOR_HPP
@@ -0,0 +1,46 @@
+#ifndef CXXMETRICS_THREAD_RANDOM_HPP
+#define CXXMETRICS_THREAD_RANDOM_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief Get a random number from a xorshift64* generator local to the calling thread
+ *
+ * This is meant for sampling on hot paths where sharing a generator between threads would be a data race
+ * and locking one would be a bottleneck. It isn't suitable for anything that needs good randomness.
+ *
+ * \return a random 64 bit number
+ */
+inline uint64_t thread_random() noexcept
+{
+    static thread_local uint64_t state = (std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())) | 1;
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * \brief Get a random number in (0, 1] from the calling thread's generator
+ */
+inline double thread_random_unit() noexcept
+{
+    return ((thread_random() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+}
+
+}
+
+#endif //CXXMETRICS_THREAD_RANDOM_HPP
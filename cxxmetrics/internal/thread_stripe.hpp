@@ -0,0 +1,55 @@
+#ifndef CXXMETRICS_THREAD_STRIPE_HPP
+#define CXXMETRICS_THREAD_STRIPE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace cxxmetrics
+{
+
+namespace internal
+{
+
+/**
+ * \brief The size that striped data is padded to in order to keep stripes off of each other's cache lines
+ */
+static constexpr std::size_t cache_line_size = 64;
+
+/**
+ * \brief Pads a stripe of striped data out to two cache lines
+ *
+ * C++14 has no aligned operator new, so alignas isn't honoured for metrics that are heap allocated, as
+ * make_shared does in the registry. Spacing the stripes two cache lines apart keeps every stripe off of its
+ * neighbours' cache lines wherever the array happens to start, as long as each stripe fits in one line.
+ *
+ * \tparam T the data in the stripe
+ */
+template<typename T>
+struct padded_stripe : T
+{
+    static_assert(sizeof(T) <= cache_line_size, "a stripe has to fit in a cache line");
+
+    char padding[2 * cache_line_size - sizeof(T)];
+};
+
+/**
+ * \brief Get a small per-thread index that can be used to pick a stripe of striped data
+ *
+ * Indexes are handed out round robin the first time a thread asks for one, so up to N threads
+ * will land on N distinct stripes rather than relying on how the thread ids happen to hash.
+ *
+ * \return the index of the calling thread
+ */
+inline std::size_t thread_stripe() noexcept
+{
+    static std::atomic<std::size_t> next(0);
+    static thread_local std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed);
+
+    return stripe;
+}
+
+}
+
+}
+
+#endif //CXXMETRICS_THREAD_STRIPE_HPP
@@ -34,43 +34,22 @@ struct meter_rate
 namespace internal
 {
 
-template<typename TClockGet, period::value TWindow, period::value TInterval>
-class rate_counter
+/**
+ * \brief The exponentially weighted rates for every window of a meter
+ *
+ * All of the windows share one running total, so a mark is one clock read and one atomic add no matter how many
+ * windows are tracked. The first mark after an interval boundary folds whatever was marked since the last fold into
+ * every window's rate, the same way an ewma ticks.
+ */
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+class meter_windows
 {
-    ewma<TClockGet, TWindow, TInterval, double> rate_;
 public:
-    rate_counter(const TClockGet &clock) noexcept :
-            rate_(clock)
-    {
-    }
-
-    rate_counter(const rate_counter &c) noexcept = default;
-    rate_counter &operator=(const rate_counter &c) noexcept = default;
-
-    void mark(int64_t value) noexcept
-    {
-        rate_.mark(value);
-    }
-
-    constexpr std::chrono::steady_clock::duration window() const noexcept
-    {
-        return period(TWindow);
-    }
-
-    double rate() const noexcept
-    {
-        return rate_.rate();
-    }
+    using clock_point = typename clock_traits<TClockGet>::clock_point;
 
-    double rate() noexcept
-    {
-        return rate_.rate();
-    }
-};
+private:
+    static constexpr std::size_t window_count = sizeof...(TWindows);
 
-template<typename TClockGet, period::value TInterval, period::value... TWindow>
-class rates_holder
-{
     template<period::value TValue, int TStart, period::value ...TPeriods>
     struct find_period;
 
@@ -88,63 +67,203 @@ class rates_holder
         static constexpr int value = -1;
     };
 
-    template<period::value ...TPeriods>
-    struct marker
+    static long double alpha(period::value window) noexcept
     {
-        static constexpr void mark(rates_holder<TClockGet, TInterval, TWindow...> *c, int64_t value)
-        {
-        }
-    };
+        return 1 - std::exp((TInterval * -1.0l) / (window * 2.0l));
+    }
 
-    template<period::value TPeriod, period::value ...TPeriods>
-    struct marker<TPeriod, TPeriods...>
+    struct window_constants
     {
-        static constexpr marker<TPeriods...> inner_ = marker<TPeriods...>();
-        static constexpr void mark(rates_holder<TClockGet, TInterval, TWindow...> *c, int64_t value)
-        {
-            c->get_rate<TPeriod>().mark(value);
-            inner_.mark(c, value);
-        }
+        long double alpha[window_count];
+        // ln(1 - alpha) so decaying over any number of idle intervals is a single exp
+        long double log_decay[window_count];
+
+        window_constants() noexcept :
+                alpha{ meter_windows::alpha(TWindows)... },
+                log_decay{ std::log1p(-meter_windows::alpha(TWindows))... }
+        { }
     };
 
-    std::tuple<rate_counter<TClockGet, TWindow, TInterval>...> rates_;
-public:
-    rates_holder(const TClockGet &clock) :
-        rates_(rate_counter<TClockGet, TWindow, TInterval>{clock}...)
+    static const window_constants &constants() noexcept
     {
+        static const window_constants c;
+        return c;
     }
 
-    rates_holder(const rates_holder &c) noexcept = default;
-    rates_holder &operator=(const rates_holder &c) noexcept
+    TClockGet clk_;
+    std::atomic<clock_point> last_;
+    // every mark goes into the total, and the part of it that's been folded into the rates is kept separately so
+    // the total never looks short while a fold is moving marks out of pending
+    std::atomic<int64_t> total_;
+    std::atomic<int64_t> folded_;
+    std::atomic<bool> started_;
+    std::atomic_flag folding_;
+    std::atomic<double> rates_[window_count];
+
+    void fold(const clock_point &at) noexcept;
+    double rate(std::size_t window, const clock_point &at) const noexcept;
+
+public:
+    explicit meter_windows(const TClockGet &clk) noexcept;
+    meter_windows(const meter_windows &other) noexcept;
+    meter_windows &operator=(const meter_windows &other) noexcept;
+
+    /**
+     * \brief Mark every window
+     *
+     * \return the time of the mark
+     */
+    clock_point mark(int64_t by) noexcept
     {
-        rates_ = c.rates_;
-        return *this;
+        auto at = clk_();
+        auto last = last_.load(std::memory_order_relaxed);
+        if (!(at < last) && (at - last) >= period(TInterval))
+            fold(at);
+
+        total_.fetch_add(by, std::memory_order_relaxed);
+        return at;
     }
 
-    template<period::value TPeriod>
-    constexpr auto &get_rate()
+    template<period::value TWindow>
+    double get_rate() const noexcept
     {
-        const int location = find_period<TPeriod, 0, TWindow...>::value;
+        constexpr int location = find_period<TWindow, 0, TWindows...>::value;
         static_assert(location >= 0, "The specified time window isn't being tracked in this rate collection");
 
-        return std::get<location>(rates_);
+        return rate(location, clk_());
     }
 
-    template<period::value TPeriod>
-    constexpr auto &get_rate() const
+    /**
+     * \brief Get the total of every mark, including the ones that haven't been folded into the rates yet
+     */
+    int64_t total() const noexcept
     {
-        const int location = find_period<TPeriod, 0, TWindow...>::value;
-        static_assert(location >= 0, "The specified time window isn't being tracked in this rate collection");
-
-        return std::get<location>(rates_);
+        return total_.load(std::memory_order_relaxed);
     }
 
-    constexpr void mark(int64_t value)
+    clock_point now() const noexcept
     {
-        marker<TWindow...>::mark(this, value);
+        return clk_();
     }
 };
 
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+meter_windows<TClockGet, TInterval, TWindows...>::meter_windows(const TClockGet &clk) noexcept :
+        clk_(clk),
+        last_(clk_()),
+        total_(0),
+        folded_(0),
+        started_(false)
+{
+    folding_.clear();
+    for (auto &r : rates_)
+        r.store(0, std::memory_order_relaxed);
+}
+
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+meter_windows<TClockGet, TInterval, TWindows...>::meter_windows(const meter_windows &other) noexcept :
+        clk_(other.clk_),
+        last_(other.last_.load()),
+        total_(other.total_.load()),
+        folded_(other.folded_.load()),
+        started_(other.started_.load())
+{
+    folding_.clear();
+    for (std::size_t i = 0; i < window_count; i++)
+        rates_[i].store(other.rates_[i].load(), std::memory_order_relaxed);
+}
+
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+meter_windows<TClockGet, TInterval, TWindows...> &meter_windows<TClockGet, TInterval, TWindows...>::operator=(const meter_windows &other) noexcept
+{
+    clk_ = other.clk_;
+    last_.store(other.last_.load());
+    total_.store(other.total_.load());
+    folded_.store(other.folded_.load());
+    started_.store(other.started_.load());
+    for (std::size_t i = 0; i < window_count; i++)
+        rates_[i].store(other.rates_[i].load(), std::memory_order_relaxed);
+
+    return *this;
+}
+
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+void meter_windows<TClockGet, TInterval, TWindows...>::fold(const clock_point &at) noexcept
+{
+    // only one thread folds, anyone else who crosses the boundary at the same time just adds to pending
+    if (folding_.test_and_set(std::memory_order_acquire))
+        return;
+
+    auto last = last_.load(std::memory_order_relaxed);
+    if (at < last || (at - last) < period(TInterval))
+    {
+        folding_.clear(std::memory_order_release);
+        return;
+    }
+
+    // only the folding thread writes folded_, so whatever's been marked since the last fold is pending
+    auto total = total_.load(std::memory_order_acquire);
+    auto pending = total - folded_.load(std::memory_order_relaxed);
+    const auto &c = constants();
+
+    if (!started_.load(std::memory_order_relaxed))
+    {
+        // the first interval sets the rates outright
+        for (auto &r : rates_)
+            r.store(pending, std::memory_order_relaxed);
+        started_.store(true, std::memory_order_release);
+    }
+    else
+    {
+        long double missed_intervals = std::floor((at - last) / period(TInterval)) - 1;
+        for (std::size_t i = 0; i < window_count; i++)
+        {
+            long double rate = rates_[i].load(std::memory_order_relaxed);
+            rate += c.alpha[i] * (pending - rate);
+
+            // averaging in a zero for every idle interval is the same as rate * (1 - alpha)^n
+            if (missed_intervals > 0)
+                rate *= std::exp(missed_intervals * c.log_decay[i]);
+            if (std::isnan(rate) || std::isinf(rate))
+                rate = 0;
+
+            rates_[i].store(static_cast<double>(rate), std::memory_order_relaxed);
+        }
+    }
+
+    folded_.store(total, std::memory_order_release);
+    last_.store(at, std::memory_order_release);
+    folding_.clear(std::memory_order_release);
+}
+
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+double meter_windows<TClockGet, TInterval, TWindows...>::rate(std::size_t window, const clock_point &at) const noexcept
+{
+    auto last = last_.load(std::memory_order_acquire);
+
+    // the total is read after what's been folded so it's never behind it
+    auto folded = folded_.load(std::memory_order_acquire);
+    auto pending = total_.load(std::memory_order_relaxed) - folded;
+    if (!started_.load(std::memory_order_acquire))
+        return pending;
+
+    // fold what's pending as if the interval ended now, without writing anything back
+    const auto &c = constants();
+    long double rate = rates_[window].load(std::memory_order_relaxed);
+    rate += c.alpha[window] * (pending - rate);
+
+    if (!(at < last))
+    {
+        long double missed_intervals = std::floor((at - last) / period(TInterval)) - 1;
+        if (missed_intervals > 0)
+            rate *= std::exp(missed_intervals * c.log_decay[window]);
+    }
+
+    if (std::isnan(rate) || std::isinf(rate))
+        return 0;
+    return static_cast<double>(rate);
+}
+
 template<typename TClockGet, period::value TInterval, period::value ... TWindows>
 class _meter_impl_base
 {
@@ -152,7 +271,7 @@ public:
     using clock_point = typename clock_traits<TClockGet>::clock_point;
     using clock_diff = typename clock_traits<TClockGet>::clock_diff;
 
-    rates_holder<TClockGet, TInterval, TWindows...> rates_;
+    meter_windows<TClockGet, TInterval, TWindows...> windows_;
 
 private:
     template<period::value... TPeriods>
@@ -189,11 +308,9 @@ private:
         }
     };
 
-    TClockGet clk_;
 public:
     explicit _meter_impl_base(const TClockGet &clkget) noexcept :
-            rates_(clkget),
-            clk_(clkget)
+            windows_(clkget)
     { }
 
     _meter_impl_base(const _meter_impl_base &b) noexcept = default;
@@ -202,13 +319,7 @@ public:
     template<period::value TPeriod>
     constexpr double get_rate() const
     {
-        return rates_.template get_rate<TPeriod>().rate();
-    }
-
-    template<period::value TPeriod>
-    constexpr double get_rate()
-    {
-        return rates_.template get_rate<TPeriod>().rate();
+        return windows_.template get_rate<TPeriod>();
     }
 
     template<typename _T>
@@ -225,9 +336,9 @@ public:
         efn.doeach(*this, fn);
     }
 
-    constexpr void mark(int64_t by)
+    clock_point mark(int64_t by)
     {
-        rates_.mark(by);
+        return windows_.mark(by);
     }
 protected:
     constexpr clock_diff interval() const noexcept
@@ -237,7 +348,7 @@ protected:
 
     clock_point now() const noexcept
     {
-        return clk_();
+        return windows_.now();
     }
 };
 
@@ -247,50 +358,34 @@ class _meter_impl : public _meter_impl_base<TClockGet, TInterval, TWindows...>
 {
     using clock_point = typename clock_traits<TClockGet>::clock_point;
     clock_point start_;
-    std::atomic_int_fast64_t total_;
 public:
     explicit _meter_impl(const TClockGet &clkget) noexcept :
             _meter_impl_base<TClockGet, TInterval, TWindows...>(clkget),
-            start_{},
-            total_(0)
+            start_{}
     { }
 
-    _meter_impl(const _meter_impl &c) noexcept :
-            _meter_impl_base<TClockGet, TInterval, TWindows...>(c),
-            start_(c.start_),
-            total_(c.total_.load())
-    {
-
-    }
-
-    _meter_impl &operator=(const _meter_impl &c) noexcept
-    {
-        _meter_impl_base<TClockGet, TInterval, TWindows...>::operator=(c);
-        start_ = c.start_;
-        total_.store(c.total_.load());
-
-        return *this;
-    }
+    _meter_impl(const _meter_impl &c) noexcept = default;
+    _meter_impl &operator=(const _meter_impl &c) noexcept = default;
 
     inline double mean() const noexcept
     {
+        auto total = this->windows_.total();
         auto since = this->now() - start_;
         auto units = (since * 1.0l) / this->interval();
         if (start_ == clock_point{})
             units = 1;
         if (!units)
-            return (total_ * 1.0l);
-        return (total_ * 1.0l) / units;
+            return (total * 1.0l);
+        return (total * 1.0l) / units;
     }
 
     void mark(int64_t by = 1)
     {
+        auto at = _meter_impl_base<TClockGet, TInterval, TWindows...>::mark(by);
+
         // this will be imperfect but it should be close enough
         if (start_ == clock_point{})
-            start_ = this->now();
-
-        _meter_impl_base<TClockGet, TInterval, TWindows...>::mark(by);
-        total_ += by;
+            start_ = at;
     }
 };
 
@@ -300,11 +395,11 @@ public:
 namespace meters
 {
 
-template<period::value TInterval, period::value ...TWindows>
-class meter : public metric<meter<TInterval, TWindows...>>
+template<typename TClockGet, period::value TInterval, period::value ...TWindows>
+class meter : public metric<meter<TClockGet, TInterval, TWindows...>>
 {
 protected:
-    internal::_meter_impl<steady_clock_point, TInterval, TWindows...> impl_;
+    internal::_meter_impl<TClockGet, TInterval, TWindows...> impl_;
     meter() noexcept;
 
     struct map_builder
@@ -352,6 +447,7 @@ public:
     inline void mark(int64_t by = 1)
     {
         impl_.mark(by);
+        this->changed();
     }
 
     /**
@@ -413,16 +509,16 @@ public:
     }
 };
 
-template<period::value TInterval, period::value ...TWindows>
-meter<TInterval, TWindows...>::meter() noexcept :
-    impl_(steady_clock_point())
+template<typename TClockGet, period::value TInterval, period::value ...TWindows>
+meter<TClockGet, TInterval, TWindows...>::meter() noexcept :
+    impl_(TClockGet())
 { }
 
-template<period::value TInterval, typename TWindows>
+template<typename TClockGet, period::value TInterval, typename TWindows>
 class meter_builder;
 
-template<period::value TInterval, period::value ...TWindows>
-class meter_builder<TInterval, templates::sortable_template_collection<TWindows...>> : public meter<TInterval, TWindows...>
+template<typename TClockGet, period::value TInterval, period::value ...TWindows>
+class meter_builder<TClockGet, TInterval, templates::sortable_template_collection<TWindows...>> : public meter<TClockGet, TInterval, TWindows...>
 {
 public:
     meter_builder() = default;
@@ -436,19 +532,28 @@ public:
 /**
  * \brief A meter that tracks the lifetime mean along with the rates specified in the template parameters
  *
+ * \tparam TClockGet the 'functor' that gets the current time
  * \tparam TWindows The various time windows to track. For example '15_min'
  */
-template<period::value TInterval, period::value... TWindows>
-class meter : public meters::meter_builder<TInterval, typename templates::sort_unique<TWindows...>::type>
+template<typename TClockGet, period::value TInterval, period::value... TWindows>
+class clocked_meter : public meters::meter_builder<TClockGet, TInterval, typename templates::sort_unique<TWindows...>::type>
 {
-    using base = meters::meter_builder<TInterval, typename templates::sort_unique<TWindows...>::type>;
+    using base = meters::meter_builder<TClockGet, TInterval, typename templates::sort_unique<TWindows...>::type>;
 public:
-    meter() noexcept = default;
-    meter(const meter& m) noexcept  = default;
-    meter& operator=(const meter& m) noexcept = default;
+    clocked_meter() noexcept = default;
+    clocked_meter(const clocked_meter& m) noexcept  = default;
+    clocked_meter& operator=(const clocked_meter& m) noexcept = default;
 
 };
 
+/**
+ * \brief A meter that tracks the lifetime mean along with the rates specified in the template parameters, using the default clock
+ *
+ * \tparam TWindows The various time windows to track. For example '15_min'
+ */
+template<period::value TInterval, period::value... TWindows>
+using meter = clocked_meter<default_clock_point, TInterval, TWindows...>;
+
 }
 
 #endif //CXXMETRICS_METER_HPP
@@ -1,6 +1,8 @@
 #ifndef CXXMETRICS_METRIC_HPP
 #define CXXMETRICS_METRIC_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <ctti/type_id.hpp>
 #include "snapshots.hpp"
 
@@ -16,11 +18,118 @@ namespace cxxmetrics
 
 namespace internal
 {
+
+/**
+ * \brief The generation that changes to metrics are stamped with
+ *
+ * Metrics don't know which registry they're in, so there's one generation for the process. Publishers that only
+ * want what changed start a new generation each time they publish and ask for the series stamped since.
+ */
+class change_generation
+{
+    static std::atomic<std::uint64_t>& value() noexcept
+    {
+        static std::atomic<std::uint64_t> generation(1);
+        return generation;
+    }
+
+public:
+    /**
+     * \brief Get the generation changes are being stamped with
+     */
+    static std::uint64_t current() noexcept
+    {
+        return value().load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Start a new generation
+     *
+     * \return the new generation
+     */
+    static std::uint64_t advance() noexcept
+    {
+        return value().fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+};
+
 class metric
 {
+    std::atomic<std::uint64_t> changed_;
+    // set while a registry sweep decides whether to drop the metric, and left set once it has been dropped
+    std::atomic<bool> retired_;
+
 public:
+    metric() noexcept :
+            changed_(change_generation::current()),
+            retired_(false)
+    { }
+
+    metric(const metric&) noexcept :
+            changed_(change_generation::current()),
+            retired_(false)
+    { }
+
+    metric& operator=(const metric&) noexcept
+    {
+        changed();
+        return *this;
+    }
+
     virtual std::string metric_type() const noexcept = 0;
     virtual ~metric() = default;
+
+    /**
+     * \brief Stamp the metric with the current change generation
+     *
+     * This is on the path of every update, so it only writes once per generation.
+     */
+    void changed() noexcept
+    {
+        auto generation = change_generation::current();
+        auto last = changed_.load(std::memory_order_relaxed);
+
+        // an update that read the generation just before it advanced mustn't move the stamp back
+        while (last < generation && !changed_.compare_exchange_weak(last, generation, std::memory_order_relaxed));
+    }
+
+    /**
+     * \brief Get the last generation the metric changed in
+     */
+    virtual std::uint64_t changed_generation() const noexcept
+    {
+        return changed_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Mark the metric as about to be dropped by a registry sweep
+     *
+     * The sweep marks the metric before it counts who holds it, and lookups copy the metric's pointer before they
+     * check the mark, with a full fence in between on both sides. So either the lookup sees the mark and goes back
+     * to the registry, or the sweep counts the lookup's copy and keeps the metric.
+     */
+    void retire() noexcept
+    {
+        retired_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * \brief Clear the mark left by retire() when the sweep decides to keep the metric after all
+     */
+    void revive() noexcept
+    {
+        retired_.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Check whether a sweep is dropping or has dropped the metric, after taking a pointer to it
+     */
+    bool retired() const noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return retired_.load(std::memory_order_relaxed);
+    }
 };
 
 template<typename TMetric>
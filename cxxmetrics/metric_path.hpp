@@ -1,63 +1,209 @@
 #ifndef CXXMETRICS_METRIC_PATH_HPP
 #define CXXMETRICS_METRIC_PATH_HPP
 
-#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <string>
+#include "internal/read_mostly_map.hpp"
+#include "internal/small_vector.hpp"
 
 namespace cxxmetrics
 {
 
+namespace internal
+{
+
+/**
+ * \brief The FNV-1a hash of a string
+ */
+constexpr std::size_t fnv1a(const char* str, std::size_t len) noexcept
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < len; ++i)
+    {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return static_cast<std::size_t>(hash);
+}
+
+/**
+ * \brief The hash of a literal path segment
+ */
+template<std::size_t Size>
+constexpr std::size_t fnv1a(const char (&str)[Size]) noexcept
+{
+    return fnv1a(str, Size - 1);
+}
+
+struct fnv1a_hash
+{
+    std::size_t operator()(const std::string& str) const noexcept
+    {
+        return fnv1a(str.data(), str.size());
+    }
+};
+
+/**
+ * \brief One segment of a metric path, shared by every path that has it
+ */
+struct path_segment
+{
+    std::string name;
+    std::size_t hash;
+};
+
+/**
+ * \brief Get the one shared copy of a path segment
+ *
+ * Interned segments live for the rest of the process. Finding a segment that's already interned compares the
+ * characters in place, so only the first lookup of a segment builds a string.
+ */
+inline const path_segment* intern_path_segment(const char* name, std::size_t len, std::size_t hash)
+{
+    static read_mostly_map<std::string, std::unique_ptr<path_segment>, fnv1a_hash> segments;
+
+    auto existing = segments.find_matching(hash, [name, len](const std::string& key) {
+        return key.size() == len && key.compare(0, len, name, len) == 0;
+    });
+    if (existing != nullptr)
+        return existing->get();
+
+    std::string key(name, len);
+    return segments.get_or_add_entry(key, hash, [&]() {
+        return std::unique_ptr<path_segment>(new path_segment{key, hash});
+    }).second->get();
+}
+
+}
+
 class metric_path;
 
 template<std::size_t Size>
 metric_path operator/(const char (&pstr)[Size], const metric_path& other);
 
+/**
+ * \brief The path that a metric is registered at
+ *
+ * Segments are interned, so a path is a short array of segment pointers plus a hash that's calculated as it's
+ * built. Comparing and hashing paths never looks at the strings, and paths up to 8 segments deep don't allocate.
+ */
 class metric_path
 {
-    std::vector<std::string> paths_;
+    static constexpr std::size_t inline_segments = 8;
+
+    internal::small_vector<const internal::path_segment*, inline_segments> paths_;
+    std::size_t hash_;
 
-    metric_path(std::vector<std::string>&& paths) :
-            paths_(std::move(paths))
+    metric_path() noexcept :
+            hash_(0)
     { }
 
+    void append(const internal::path_segment* segment)
+    {
+        paths_.emplace_back(segment);
+        hash_ = (hash_ * 397) ^ segment->hash;
+    }
+
+    void append(const char* pstr, std::size_t len)
+    {
+        if (len)
+            append(internal::intern_path_segment(pstr, len, internal::fnv1a(pstr, len)));
+    }
+
     template<std::size_t Size>
     friend metric_path operator/(const char (&pstr)[Size], const metric_path& other);
 
 public:
+    /**
+     * \brief Iterates the names of the segments in a path
+     */
+    class iterator
+    {
+        const internal::path_segment* const* at_;
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        explicit iterator(const internal::path_segment* const* at) noexcept :
+                at_(at)
+        { }
+
+        const std::string& operator*() const noexcept { return (*at_)->name; }
+        const std::string* operator->() const noexcept { return &(*at_)->name; }
+
+        iterator& operator++() noexcept
+        {
+            ++at_;
+            return *this;
+        }
+
+        iterator operator++(int) noexcept
+        {
+            auto result = *this;
+            ++at_;
+            return result;
+        }
+
+        bool operator==(const iterator& other) const noexcept { return at_ == other.at_; }
+        bool operator!=(const iterator& other) const noexcept { return at_ != other.at_; }
+    };
+
     template<std::size_t Size>
-    constexpr metric_path(const char (&pstr)[Size])
+    metric_path(const char (&pstr)[Size]) :
+            hash_(0)
     {
+        // the literal's length is known, so it isn't scanned for
         if (Size > 1)
-            paths_.emplace_back(std::string(pstr, Size-1));
+            append(internal::intern_path_segment(pstr, Size - 1, internal::fnv1a(pstr)));
     }
 
-    metric_path(const char* pstr, std::size_t len = 0)
+    metric_path(const char* pstr, std::size_t len = 0) :
+            hash_(0)
     {
         if (pstr && *pstr)
-        {
-            if (len)
-                paths_.emplace_back(pstr, len);
-            else
-                paths_.emplace_back(pstr);
-        }
+            append(pstr, len ? len : std::char_traits<char>::length(pstr));
     }
 
-    metric_path(std::string pstr)
+    metric_path(const std::string& pstr) :
+            hash_(0)
     {
-        if (!pstr.empty())
-            paths_.emplace_back(std::move(pstr));
+        append(pstr.data(), pstr.size());
     }
 
+    metric_path(const metric_path&) = default;
+    metric_path(metric_path&&) = default;
+    metric_path& operator=(const metric_path&) = default;
+    metric_path& operator=(metric_path&&) = default;
+
     std::string join(const std::string& delim) const;
 
-    auto begin() const
+    iterator begin() const
+    {
+        return iterator(paths_.begin());
+    }
+
+    iterator end() const
+    {
+        return iterator(paths_.end());
+    }
+
+    std::size_t size() const noexcept
     {
-        return paths_.begin();
+        return paths_.size();
     }
 
-    auto end() const
+    /**
+     * \brief Get the hash of the path, which is calculated as the path is built
+     */
+    std::size_t hash() const noexcept
     {
-        return paths_.end();
+        return hash_;
     }
 
     bool operator==(const metric_path& other) const;
@@ -70,9 +216,14 @@ public:
         if (other.paths_.empty())
             return *this;
 
-        auto paths = paths_;
-        paths.insert(paths.end(), other.paths_.begin(), other.paths_.end());
-        return metric_path(std::move(paths));
+        metric_path result;
+        result.paths_.reserve(paths_.size() + other.paths_.size());
+        for (auto segment : paths_)
+            result.append(segment);
+        for (auto segment : other.paths_)
+            result.append(segment);
+
+        return result;
     }
 };
 
@@ -84,16 +235,16 @@ inline std::string metric_path::join(const std::string &delim) const
     // probably faster to calculate the size and then build the result
     std::string result;
     std::size_t len = 0;
-    for (auto& str : paths_)
-        len += str.length() + delim.length();
+    for (auto segment : paths_)
+        len += segment->name.length() + delim.length();
     len -= delim.length(); // cut the last one
 
     result.reserve(len + 1);
-    result += paths_[0];
+    result += paths_[0]->name;
     for (std::size_t i = 1; i < paths_.size(); ++i)
     {
         result += delim;
-        result += paths_[i];
+        result += paths_[i]->name;
     }
 
     return result;
@@ -101,7 +252,7 @@ inline std::string metric_path::join(const std::string &delim) const
 
 inline bool metric_path::operator==(const cxxmetrics::metric_path &other) const
 {
-    if (paths_.size() != other.paths_.size())
+    if (hash_ != other.hash_ || paths_.size() != other.paths_.size())
         return false;
 
     for (std::size_t i = 0; i < paths_.size(); ++i)
@@ -121,13 +272,12 @@ inline bool metric_path::operator!=(const cxxmetrics::metric_path &other) const
 template<std::size_t Size>
 inline metric_path operator/(const char (&pstr)[Size], const metric_path& other)
 {
-    std::vector<std::string> paths;
-    paths.reserve(other.paths_.size() + 1);
-
-    paths.emplace_back(pstr);
-    paths.insert(paths.end(), other.paths_.begin(), other.paths_.end());
+    metric_path result(pstr);
+    result.paths_.reserve(result.paths_.size() + other.paths_.size());
+    for (auto segment : other.paths_)
+        result.append(segment);
 
-    return metric_path(std::move(paths));
+    return result;
 }
 
 }
@@ -149,12 +299,7 @@ namespace std
     {
         std::size_t operator()(const cxxmetrics::metric_path& path) const
         {
-            std::size_t result = 0;
-            std::hash<string> h;
-            for (const auto& str : path)
-                result = (result * 397) ^ h(str);
-
-            return result;
+            return path.hash();
         }
     };
 }
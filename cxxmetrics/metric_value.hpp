@@ -5,6 +5,10 @@
 #include <string>
 #include <cmath>
 #include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <ratio>
 #include "time.hpp"
 
 namespace cxxmetrics
@@ -13,695 +17,793 @@ namespace cxxmetrics
 namespace internal
 {
 
-class variant_data
+/**
+ * \brief The data behind a metric_value
+ *
+ * This is a tagged union rather than a class hierarchy so that copying, comparing and doing arithmetic
+ * on values (which happens a lot when sorting and merging snapshots) can all be inlined without any
+ * virtual dispatch. The comparisons between values of the same kind are checked first for the same reason.
+ *
+ * Durations keep their own count along with the ratio of their period to nanoseconds so that they
+ * still format in their own units. Durations with floating point reps keep a floating point count.
+ */
+class variant_data_holder
 {
-public:
-    virtual ~variant_data() = default;
-    virtual std::string to_string() const = 0;
-    virtual long long to_integral(bool* valid) const = 0;
-    virtual long double to_float(bool* valid) const = 0;
-    virtual std::chrono::nanoseconds to_nanos(bool* valid) const = 0;
-    virtual int type_score() const = 0;
-    virtual std::size_t hash_value() const = 0;
-    virtual void copy(void* into) const noexcept = 0;
-    virtual void move(void* into) noexcept { return copy(into); }
-    virtual void add(const variant_data& other) noexcept = 0;
-    virtual void multiply(const variant_data& other) noexcept = 0;
-    virtual void divide(const variant_data& other) noexcept = 0;
-    virtual void negate() noexcept = 0;
-    virtual void bitwise_negate() noexcept = 0;
-    virtual int compare(const variant_data& other) const noexcept = 0;
-};
+    enum class data_kind : unsigned char
+    {
+        string,
+        signed_integral,
+        unsigned_integral,
+        duration,
+        floating_duration,
+        floating
+    };
 
-template<typename T>
-class integral_variant_data : public variant_data
-{
-    static_assert(std::is_integral<T>::value, "Expected an integral type for integral variant data");
-    T val_;
-public:
-    integral_variant_data(T value) :
-            val_(value)
-    { }
+    struct duration_data
+    {
+        long long count;
+        long long nanos_num;
+        long long nanos_den;
+    };
 
-    std::string to_string() const override
+    struct floating_duration_data
     {
-        return std::to_string(val_);
-    }
+        long double count;
+        long long nanos_num;
+        long long nanos_den;
+    };
 
-    long long to_integral(bool* valid) const override
+    union
     {
-        if (valid)
-            *valid = true;
-        return static_cast<long long>(val_);
-    }
+        long long int_;
+        unsigned long long uint_;
+        long double float_;
+        duration_data dur_;
+        floating_duration_data fdur_;
+        std::string str_;
+    };
+    data_kind kind_;
 
-    long double to_float(bool* valid) const override
+    template<typename T>
+    struct int_float_initializer
     {
-        if (valid)
-            *valid = true;
-        return static_cast<long double>(val_);
+        void operator()(variant_data_holder& into, T value, std::true_type) const
+        {
+            into.kind_ = data_kind::floating;
+            into.float_ = static_cast<long double>(value);
+        }
+
+        void operator()(variant_data_holder& into, T value, std::false_type) const
+        {
+            if (std::is_signed<T>::value)
+            {
+                into.kind_ = data_kind::signed_integral;
+                into.int_ = static_cast<long long>(value);
+            }
+            else
+            {
+                into.kind_ = data_kind::unsigned_integral;
+                into.uint_ = static_cast<unsigned long long>(value);
+            }
+        }
+    };
+
+    static int compare_values(long double a, long double b) noexcept
+    {
+        return a < b ? -1 : a == b ? 0 : 1;
     }
 
-    std::chrono::nanoseconds to_nanos(bool* valid) const override
+    static int compare_values(long long a, long long b) noexcept
     {
-        return std::chrono::nanoseconds(to_integral(valid));
+        return a < b ? -1 : a == b ? 0 : 1;
     }
 
-    std::size_t hash_value() const override
+    static int compare_values(unsigned long long a, unsigned long long b) noexcept
     {
-        return std::hash<T>()(val_);
+        return a < b ? -1 : a == b ? 0 : 1;
     }
 
-    void copy(void* into) const noexcept override
+    long long nanos_to_count(long long nanos) const noexcept
     {
-        new (reinterpret_cast<integral_variant_data<T>*>(into)) integral_variant_data<T>(val_);
+        return (nanos * dur_.nanos_den) / dur_.nanos_num;
     }
 
-    int type_score() const override
+    // nanoseconds without rounding away the fraction of a floating point duration
+    long double precise_nanos() const noexcept
     {
-        return (sizeof(T) * 10) + (std::is_signed<T>::value ? 0 : 1);
+        if (kind_ == data_kind::floating_duration)
+            return (fdur_.count * fdur_.nanos_num) / fdur_.nanos_den;
+        return static_cast<long double>(to_nanos().count());
     }
 
-    void add(const variant_data& other) noexcept override
+    bool floating_point() const noexcept
     {
-        bool valid;
-        auto lv = other.to_integral(&valid);
-        if (valid)
-            val_ += lv;
-        else
-            val_ += other.to_float(nullptr);
+        return kind_ == data_kind::floating || kind_ == data_kind::floating_duration;
     }
 
-    void multiply(const variant_data& other) noexcept override
+    // the type score decides which side of a binary operation determines the result type
+    int type_score() const noexcept
     {
-        bool valid;
-        auto lv = other.to_integral(&valid);
-        if (valid)
-        {
-            val_ *= lv;
-        }
-        else
+        switch (kind_)
         {
-            auto fv = other.to_float(&valid);
-            if (valid)
-                val_ *= fv;
+            case data_kind::signed_integral:
+                return 80;
+            case data_kind::unsigned_integral:
+                return 81;
+            case data_kind::duration:
+                return 82;
+            case data_kind::floating_duration:
+                return 83;
+            case data_kind::floating:
+                return 320;
+            default:
+                return 1;
         }
     }
 
-    void divide(const variant_data& other) noexcept override
+    void copy_from(const variant_data_holder& other)
     {
-        bool valid;
-        auto lv = other.to_integral(&valid);
-        if (valid)
+        kind_ = other.kind_;
+        switch (kind_)
         {
-            if (!lv)
-                val_ = 0;
-            else
-                val_ /= lv;
-        }
-        else
-        {
-            auto fv = other.to_float(&valid);
-            if (valid)
-            {
-                if (!fv)
-                    val_ = 0;
-                else
-                    val_ /= fv;
-            }
+            case data_kind::string:
+                new (&str_) std::string(other.str_);
+                break;
+            case data_kind::duration:
+                dur_ = other.dur_;
+                break;
+            case data_kind::floating_duration:
+                fdur_ = other.fdur_;
+                break;
+            case data_kind::floating:
+                float_ = other.float_;
+                break;
+            default:
+                uint_ = other.uint_;
+                break;
         }
     }
 
-    void negate() noexcept override
+    void move_from(variant_data_holder&& other) noexcept
     {
-        val_ = -val_;
+        kind_ = other.kind_;
+        switch (kind_)
+        {
+            case data_kind::string:
+                new (&str_) std::string(std::move(other.str_));
+                break;
+            case data_kind::duration:
+                dur_ = other.dur_;
+                break;
+            case data_kind::floating_duration:
+                fdur_ = other.fdur_;
+                break;
+            case data_kind::floating:
+                float_ = other.float_;
+                break;
+            default:
+                uint_ = other.uint_;
+                break;
+        }
     }
 
-    void bitwise_negate() noexcept override
+    void destroy() noexcept
     {
-        val_ = ~val_;
+        if (kind_ == data_kind::string)
+            str_.~basic_string();
     }
 
-    int compare(const variant_data& other) const noexcept override
-    {
-        bool valid;
-        auto lv = static_cast<T>(other.to_integral(&valid));
-        if (!valid)
-        {
-            auto fv = other.to_float(&valid);
-            if (!valid)
-                return -1;
-
-            return val_ < fv ? -1 : val_ == fv ? 0 : 1;
-        }
+    void add_in_place(const variant_data_holder& other) noexcept;
+    void multiply_in_place(const variant_data_holder& other) noexcept;
+    void divide_in_place(const variant_data_holder& other) noexcept;
 
-        return val_ - lv;
-    }
-};
+    long long parse_integral(bool* valid) const noexcept;
+    long double parse_float(bool* valid) const noexcept;
 
-template<typename T>
-class float_variant_data : public variant_data
-{
-    static_assert(std::is_floating_point<T>::value, "Expected an integral type for integral variant data");
-    T val_;
 public:
-    float_variant_data(T value) :
-            val_(value)
-    { }
-
-    virtual std::string to_string() const override
-    {
-        return std::to_string(val_);
-    }
-
-    virtual long long to_integral(bool* valid) const override
+    template<typename TInt, typename = typename std::enable_if<std::is_integral<TInt>::value || std::is_floating_point<TInt>::value, void>::type>
+    variant_data_holder(TInt value) noexcept
     {
-        if (valid)
-            *valid = true;
-        return static_cast<long long>(std::round(val_));
+        int_float_initializer<TInt> init;
+        init(*this, value, std::is_floating_point<TInt>());
     }
 
-    virtual long double to_float(bool* valid) const override
-    {
-        if (valid)
-            *valid = true;
-        return static_cast<long double>(val_);
-    }
+    variant_data_holder(std::string value) noexcept :
+            str_(std::move(value)),
+            kind_(data_kind::string)
+    { }
 
-    std::chrono::nanoseconds to_nanos(bool* valid) const override
-    {
-        if (valid)
-            *valid = true;
-        return std::chrono::nanoseconds(to_integral(nullptr));
-    }
+    variant_data_holder(const char* value) :
+            str_(value),
+            kind_(data_kind::string)
+    { }
 
-    std::size_t hash_value() const override
+    template<typename TRep, typename TPeriod, typename = typename std::enable_if<!std::is_floating_point<TRep>::value, void>::type>
+    variant_data_holder(std::chrono::duration<TRep, TPeriod> value) noexcept :
+            kind_(data_kind::duration)
     {
-        return std::hash<T>()(val_);
+        using nanos_ratio = std::ratio_divide<TPeriod, std::nano>;
+        dur_.count = static_cast<long long>(value.count());
+        dur_.nanos_num = nanos_ratio::num;
+        dur_.nanos_den = nanos_ratio::den;
     }
 
-    void copy(void* into) const noexcept override
+    template<typename TRep, typename TPeriod, typename std::enable_if<std::is_floating_point<TRep>::value, int>::type = 0>
+    variant_data_holder(std::chrono::duration<TRep, TPeriod> value) noexcept :
+            kind_(data_kind::floating_duration)
     {
-        new (reinterpret_cast<float_variant_data<T>*>(into)) float_variant_data<T>(val_);
+        using nanos_ratio = std::ratio_divide<TPeriod, std::nano>;
+        fdur_.count = static_cast<long double>(value.count());
+        fdur_.nanos_num = nanos_ratio::num;
+        fdur_.nanos_den = nanos_ratio::den;
     }
 
-    int type_score() const override
+    variant_data_holder(const variant_data_holder& from)
     {
-        return (sizeof(T) * 20);
+        copy_from(from);
     }
 
-    void add(const variant_data& other) noexcept override
+    variant_data_holder(variant_data_holder&& from) noexcept
     {
-        val_ += other.to_float(nullptr);
+        move_from(std::move(from));
     }
 
-    void multiply(const variant_data& other) noexcept override
+    ~variant_data_holder()
     {
-        bool valid;
-        auto fv = other.to_float(&valid);
-        if (valid)
-            val_ *= fv;
+        destroy();
     }
 
-    void divide(const variant_data& other) noexcept override
+    variant_data_holder& operator=(const variant_data_holder& other)
     {
-        bool valid;
-        auto fv = other.to_float(&valid);
-        if (valid)
+        if (this != &other)
         {
-            if (!fv)
-                val_ = 0;
-            else
-                val_ /= fv;
+            destroy();
+            copy_from(other);
         }
+        return *this;
     }
 
-    void negate() noexcept override
-    {
-        val_ = -val_;
-    }
-
-    void bitwise_negate() noexcept override
-    {
-    }
-
-    int compare(const variant_data& other) const noexcept override
+    variant_data_holder& operator=(variant_data_holder&& other) noexcept
     {
-        bool valid;
-        auto fv = static_cast<T>(other.to_float(&valid));
-        if (!valid)
-            return -1;
-
-        return val_ < fv ? -1 : val_ == fv ? 0 : 1;
+        if (this != &other)
+        {
+            destroy();
+            move_from(std::move(other));
+        }
+        return *this;
     }
-};
-
-class string_variant_data : public variant_data
-{
-    std::string val_;
-public:
-    string_variant_data(std::string value) :
-            val_(std::move(value))
-    { }
 
-    std::string to_string() const override
+    long long to_integral(bool* valid = nullptr) const noexcept
     {
-        return val_;
+        switch (kind_)
+        {
+            case data_kind::string:
+                return parse_integral(valid);
+            case data_kind::floating:
+                if (valid)
+                    *valid = true;
+                return static_cast<long long>(std::round(float_));
+            case data_kind::duration:
+                if (valid)
+                    *valid = true;
+                return dur_.count;
+            case data_kind::floating_duration:
+                if (valid)
+                    *valid = true;
+                return static_cast<long long>(std::round(fdur_.count));
+            default:
+                if (valid)
+                    *valid = true;
+                return int_;
+        }
     }
 
-    long long to_integral(bool* valid) const override
+    long double to_float(bool* valid = nullptr) const noexcept
     {
-        static bool ign;
-        if (valid == nullptr)
-            valid = &ign;
-        if (!val_.length())
+        switch (kind_)
         {
-            *valid = false;
-            return 0;
+            case data_kind::string:
+                return parse_float(valid);
+            case data_kind::floating:
+                if (valid)
+                    *valid = true;
+                return float_;
+            case data_kind::duration:
+                if (valid)
+                    *valid = true;
+                return static_cast<long double>(dur_.count);
+            case data_kind::floating_duration:
+                if (valid)
+                    *valid = true;
+                return fdur_.count;
+            case data_kind::unsigned_integral:
+                if (valid)
+                    *valid = true;
+                return static_cast<long double>(uint_);
+            default:
+                if (valid)
+                    *valid = true;
+                return static_cast<long double>(int_);
         }
+    }
 
-        char* end = nullptr;
-        if (val_[0] == '-')
+    std::chrono::nanoseconds to_nanos(bool* valid = nullptr) const noexcept
+    {
+        switch (kind_)
         {
-            auto res = strtoll(val_.c_str(), &end, 10);
-            if (!end || *end)
+            case data_kind::duration:
+                if (valid)
+                    *valid = true;
+                return std::chrono::nanoseconds((dur_.count * dur_.nanos_num) / dur_.nanos_den);
+            case data_kind::floating_duration:
+                if (valid)
+                    *valid = true;
+                return std::chrono::nanoseconds(std::llround(precise_nanos()));
+            case data_kind::string:
             {
-                *valid = false;
-                return 0;
-            }
+                bool lvalid;
+                auto lv = parse_integral(&lvalid);
+                if (lvalid)
+                    return std::chrono::nanoseconds(lv);
 
-            *valid = true;
-            return res;
-        }
-
-        auto res = strtoull(val_.c_str(), &end, 10);
-        if (!end || *end)
-        {
-            *valid = false;
-            return 0;
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<long double, std::chrono::nanoseconds::period>(parse_float(valid)));
+            }
+            default:
+                return std::chrono::nanoseconds(to_integral(valid));
         }
-        *valid = true;
-        return res;
     }
 
-    long double to_float(bool *valid) const override
+    template<typename THandler>
+    void visit(THandler&& handler) const
     {
-        static bool ign;
-        if (valid == nullptr)
-            valid = &ign;
-        if (!val_.length())
+        switch (kind_)
         {
-            *valid = false;
-            return std::numeric_limits<long double>::quiet_NaN();
+            case data_kind::string:
+                handler(str_);
+                break;
+            case data_kind::floating:
+                handler(float_);
+                break;
+            case data_kind::duration:
+                handler(dur_.count);
+                break;
+            case data_kind::floating_duration:
+                handler(fdur_.count);
+                break;
+            case data_kind::unsigned_integral:
+                handler(uint_);
+                break;
+            default:
+                handler(int_);
+                break;
         }
-
-        char* end = nullptr;
-        auto res = strtold(val_.c_str(), &end);
-        if (!end || *end)
-        {
-            *valid = false;
-            return std::numeric_limits<long double>::quiet_NaN();
-        }
-        *valid = true;
-        return res;
     }
 
-    std::chrono::nanoseconds to_nanos(bool* valid) const override
+    std::string to_string() const
     {
-        bool lvalid;
-        auto lv = to_integral(&lvalid);
-        if (lvalid)
-            return std::chrono::nanoseconds(lv);
-
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<long double, std::chrono::nanoseconds::period>(to_float(nullptr)));
+        switch (kind_)
+        {
+            case data_kind::string:
+                return str_;
+            case data_kind::floating:
+                return std::to_string(float_);
+            case data_kind::duration:
+                return std::to_string(dur_.count);
+            case data_kind::floating_duration:
+                return std::to_string(fdur_.count);
+            case data_kind::unsigned_integral:
+                return std::to_string(uint_);
+            default:
+                return std::to_string(int_);
+        }
     }
 
-    std::size_t hash_value() const override
-    {
-        return std::hash<std::string>()(val_);
-    }
+    int compare(const variant_data_holder& other) const noexcept;
 
-    void copy(void* into) const noexcept override
+    variant_data_holder add(const variant_data_holder& other) const
     {
-        new (reinterpret_cast<string_variant_data*>(into)) string_variant_data(val_);
-    }
+        if (other.type_score() > type_score())
+            return other.add(*this);
 
-    void move(void* into) noexcept override
-    {
-        new (reinterpret_cast<string_variant_data*>(into)) string_variant_data(std::move(val_));
+        variant_data_holder result(*this);
+        result.add_in_place(other);
+        return result;
     }
 
-    int type_score() const override
+    variant_data_holder multiply(const variant_data_holder& other) const
     {
-        return 1;
-    }
+        if (other.type_score() > type_score())
+            return other.multiply(*this);
 
-    void add(const variant_data& other) noexcept override
-    {
-        val_ += other.to_string();
+        variant_data_holder result(*this);
+        result.multiply_in_place(other);
+        return result;
     }
 
-    void multiply(const variant_data& other) noexcept override
+    variant_data_holder divide(const variant_data_holder& other) const
     {
-    }
+        if (other.type_score() > type_score())
+            return other.divide(*this);
 
-    void divide(const variant_data& other) noexcept override
-    {
+        variant_data_holder result(*this);
+        result.divide_in_place(other);
+        return result;
     }
 
-    void negate() noexcept override
+    variant_data_holder negate() const
     {
-        bool valid;
-        auto lv = to_integral(&valid);
-        if (valid)
+        variant_data_holder result(*this);
+        switch (kind_)
         {
-            val_ = std::to_string(-lv);
-            return;
+            case data_kind::string:
+            {
+                bool valid;
+                auto lv = parse_integral(&valid);
+                if (valid)
+                {
+                    result.str_ = std::to_string(-lv);
+                    break;
+                }
+
+                auto fv = parse_float(&valid);
+                if (valid)
+                    result.str_ = std::to_string(-fv);
+                break;
+            }
+            case data_kind::floating:
+                result.float_ = -float_;
+                break;
+            case data_kind::duration:
+                result.dur_.count = -dur_.count;
+                break;
+            case data_kind::floating_duration:
+                result.fdur_.count = -fdur_.count;
+                break;
+            case data_kind::unsigned_integral:
+                result.uint_ = -uint_;
+                break;
+            default:
+                result.int_ = -int_;
+                break;
         }
 
-        auto fv = to_float(&valid);
-        if (valid)
-            val_ = std::to_string(-fv);
+        return result;
     }
 
-    void bitwise_negate() noexcept override
+    variant_data_holder bitwise_negate() const
     {
-        bool valid;
-        auto lv = to_integral(&valid);
-        if (valid)
+        variant_data_holder result(*this);
+        switch (kind_)
         {
-            val_ = std::to_string(~lv);
-            return;
+            case data_kind::string:
+            {
+                bool valid;
+                auto lv = parse_integral(&valid);
+                if (valid)
+                    result.str_ = std::to_string(~lv);
+                break;
+            }
+            case data_kind::signed_integral:
+            case data_kind::unsigned_integral:
+                result.uint_ = ~uint_;
+                break;
+            default:
+                break;
         }
+
+        return result;
     }
 
-    int compare(const variant_data& other) const noexcept override
+    std::size_t hash_value() const
     {
-        return val_.compare(other.to_string());
+        switch (kind_)
+        {
+            case data_kind::string:
+                return std::hash<std::string>()(str_);
+            case data_kind::floating:
+                return std::hash<long double>()(float_);
+            case data_kind::duration:
+                return std::hash<long long>()(dur_.count);
+            case data_kind::floating_duration:
+                return std::hash<long double>()(fdur_.count);
+            case data_kind::unsigned_integral:
+                return std::hash<unsigned long long>()(uint_);
+            default:
+                return std::hash<long long>()(int_);
+        }
     }
 };
 
-template<typename TRep, typename TPeriod>
-class duration_variant_data : public variant_data
+inline long long variant_data_holder::parse_integral(bool* valid) const noexcept
 {
-    std::chrono::duration<TRep, TPeriod> dur_;
-public:
-    duration_variant_data(std::chrono::duration<TRep, TPeriod> value) :
-            dur_(value)
-    { }
-
-    std::string to_string() const override
-    {
-        return std::to_string(dur_.count());
-    }
-
-    long long to_integral(bool* valid) const override
+    static bool ign;
+    if (valid == nullptr)
+        valid = &ign;
+    if (!str_.length())
     {
-        if (valid)
-            *valid = true;
-        return static_cast<long long>(dur_.count());
+        *valid = false;
+        return 0;
     }
 
-    long double to_float(bool* valid) const override
+    char* end = nullptr;
+    if (str_[0] == '-')
     {
-        if (valid)
-            *valid = true;
-        return static_cast<long double>(dur_.count());
-    }
+        auto res = strtoll(str_.c_str(), &end, 10);
+        if (!end || *end)
+        {
+            *valid = false;
+            return 0;
+        }
 
-    std::chrono::nanoseconds to_nanos(bool* valid) const override
-    {
-        if (valid)
-            *valid = true;
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(dur_);
+        *valid = true;
+        return res;
     }
 
-    std::size_t hash_value() const override
+    auto res = strtoull(str_.c_str(), &end, 10);
+    if (!end || *end)
     {
-        return std::hash<std::chrono::duration<TRep, TPeriod>>()(dur_);
+        *valid = false;
+        return 0;
     }
+    *valid = true;
+    return res;
+}
 
-    void copy(void* into) const noexcept override
+inline long double variant_data_holder::parse_float(bool* valid) const noexcept
+{
+    static bool ign;
+    if (valid == nullptr)
+        valid = &ign;
+    if (!str_.length())
     {
-        new (reinterpret_cast<duration_variant_data<TRep, TPeriod>*>(into)) duration_variant_data<TRep, TPeriod>(dur_);
+        *valid = false;
+        return std::numeric_limits<long double>::quiet_NaN();
     }
 
-    int type_score() const override
+    char* end = nullptr;
+    auto res = strtold(str_.c_str(), &end);
+    if (!end || *end)
     {
-        if (std::is_floating_point<TRep>::value)
-            return (sizeof(TRep) * 20) + 2;
-        else
-            return (sizeof(TRep) * 10) + 2;
+        *valid = false;
+        return std::numeric_limits<long double>::quiet_NaN();
     }
+    *valid = true;
+    return res;
+}
 
-    void add(const variant_data& other) noexcept override
+inline int variant_data_holder::compare(const variant_data_holder& other) const noexcept
+{
+    // the common case of sorting values of the same kind
+    if (kind_ == other.kind_)
     {
-        dur_ += std::chrono::duration_cast<std::chrono::duration<TRep, TPeriod>>(other.to_nanos(nullptr));
+        switch (kind_)
+        {
+            case data_kind::signed_integral:
+                return compare_values(int_, other.int_);
+            case data_kind::unsigned_integral:
+                return compare_values(uint_, other.uint_);
+            case data_kind::floating:
+                return compare_values(float_, other.float_);
+            case data_kind::duration:
+                if (dur_.nanos_num == other.dur_.nanos_num && dur_.nanos_den == other.dur_.nanos_den)
+                    return compare_values(dur_.count, other.dur_.count);
+                break;
+            case data_kind::floating_duration:
+                if (fdur_.nanos_num == other.fdur_.nanos_num && fdur_.nanos_den == other.fdur_.nanos_den)
+                    return compare_values(fdur_.count, other.fdur_.count);
+                break;
+            default:
+                return str_.compare(other.str_);
+        }
     }
 
-    void multiply(const variant_data& other) noexcept override
+    bool valid;
+    switch (kind_)
     {
-        bool valid;
-        auto lv = other.to_integral(&valid);
-        if (!valid)
+        case data_kind::string:
+            return str_.compare(other.to_string());
+        case data_kind::floating:
         {
             auto fv = other.to_float(&valid);
             if (!valid)
-                return;
-
-            dur_ *= fv;
-            return;
+                return -1;
+            return compare_values(float_, fv);
         }
-
-        dur_ *= lv;
+        case data_kind::duration:
+            if (other.kind_ == data_kind::floating_duration)
+                return compare_values(precise_nanos(), other.precise_nanos());
+            return compare_values(static_cast<long long>(to_nanos().count()), static_cast<long long>(other.to_nanos().count()));
+        case data_kind::floating_duration:
+            return compare_values(precise_nanos(), other.precise_nanos());
+        default:
+            break;
     }
 
-    void divide(const variant_data& other) noexcept override
+    // integral values
+    if (!other.floating_point())
     {
-        bool valid;
         auto lv = other.to_integral(&valid);
-        if (!valid)
+        if (valid)
         {
-            auto fv = other.to_float(&valid);
-            if (!valid)
-                return;
-
-            if (!fv)
-                dur_ = dur_.zero();
-            else
-                dur_ /= fv;
-
-            return;
+            if (kind_ == data_kind::unsigned_integral)
+                return lv < 0 ? 1 : compare_values(uint_, static_cast<unsigned long long>(lv));
+            if (other.kind_ == data_kind::unsigned_integral && other.uint_ > static_cast<unsigned long long>(std::numeric_limits<long long>::max()))
+                return -1;
+            return compare_values(int_, lv);
         }
-
-        if (!lv)
-            dur_ = dur_.zero();
-        else
-            dur_ /= lv;
     }
 
-    void negate() noexcept override
-    {
-        dur_ = -dur_;
-    }
-
-    void bitwise_negate() noexcept override
-    {
-    }
+    auto fv = other.to_float(&valid);
+    if (!valid)
+        return -1;
 
-    int compare(const variant_data& other) const noexcept override
-    {
-        bool valid;
-        auto n = other.to_nanos(&valid);
-        return dur_ < n ? -1 : dur_ == n ? 0 : 1;
-    }
-};
+    return compare_values(to_float(), fv);
+}
 
-class variant_data_holder
+inline void variant_data_holder::add_in_place(const variant_data_holder& other) noexcept
 {
-    std::aligned_union<sizeof(std::max_align_t),
-             integral_variant_data<long long>,
-             float_variant_data<long double>,
-             string_variant_data,
-             duration_variant_data<long long, typename std::chrono::nanoseconds::period>
-    >::type v;
-
-    template<typename T>
-    T* as()
-    {
-        return reinterpret_cast<T*>(std::addressof(v));
-    }
-
-    template<typename T>
-    const T* as() const
-    {
-        return reinterpret_cast<const T*>(std::addressof(v));
-    }
-
-    variant_data_holder(const variant_data* cp)
-    {
-        cp->copy(std::addressof(v));
-    }
-
-    variant_data_holder uc_add(const variant_data_holder& other) const
-    {
-        variant_data_holder result(as<variant_data>());
-        result.as<variant_data>()->add(*other.as<variant_data>());
-
-        return result;
-    }
-
-    variant_data_holder uc_mult(const variant_data_holder& other) const
-    {
-        variant_data_holder result(as<variant_data>());
-        result.as<variant_data>()->multiply(*other.as<variant_data>());
-
-        return result;
-    }
-
-    variant_data_holder uc_div(const variant_data_holder& other) const
-    {
-        variant_data_holder result(as<variant_data>());
-        result.as<variant_data>()->divide(*other.as<variant_data>());
-
-        return result;
-    }
-
-    template<typename T, typename>
-    struct float_int_initializer;
-
-    template<typename _T>
-    struct float_int_initializer<_T, typename std::enable_if<std::is_integral<_T>::value, void>::type>
-    {
-        void operator()(void* data, _T value) const
+    bool valid;
+    switch (kind_)
+    {
+        case data_kind::string:
+            str_ += other.to_string();
+            break;
+        case data_kind::floating:
+            float_ += other.to_float();
+            break;
+        case data_kind::duration:
+            dur_.count += nanos_to_count(other.to_nanos().count());
+            break;
+        case data_kind::floating_duration:
+            fdur_.count += (other.precise_nanos() * fdur_.nanos_den) / fdur_.nanos_num;
+            break;
+        case data_kind::unsigned_integral:
         {
-            new (data) integral_variant_data<_T>(value);
+            auto lv = other.to_integral(&valid);
+            if (valid)
+                uint_ += lv;
+            else
+                uint_ += other.to_float();
+            break;
         }
-    };
-
-    template<typename _T>
-    struct float_int_initializer<_T, typename std::enable_if<std::is_floating_point<_T>::value, void>::type>
-    {
-        void operator()(void* data, _T value) const
+        default:
         {
-            new (data) float_variant_data<_T>(value);
+            auto lv = other.to_integral(&valid);
+            if (valid)
+                int_ += lv;
+            else
+                int_ += other.to_float();
+            break;
         }
-    };
-
-public:
-    template<typename TInt, typename = typename std::enable_if<std::is_integral<TInt>::value || std::is_floating_point<TInt>::value, void>::type>
-    variant_data_holder(TInt value)
-    {
-        float_int_initializer<TInt, void> init;
-        init(as<void>(), value);
-    }
-
-    variant_data_holder(std::string value)
-    {
-        new (as<string_variant_data>()) string_variant_data(std::move(value));
-    }
-
-    variant_data_holder(const char* value)
-    {
-        new (as<string_variant_data>()) string_variant_data(value);
-    }
-
-    variant_data_holder(const variant_data_holder& from)
-    {
-        from.as<variant_data>()->copy(std::addressof(v));
-    }
-
-    variant_data_holder(variant_data_holder&& from)
-    {
-        from.as<variant_data>()->move(std::addressof(v));
-    }
-
-    template<typename TRep, typename TPeriod>
-    variant_data_holder(std::chrono::duration<TRep, TPeriod> value)
-    {
-        new (as<duration_variant_data<TRep, TPeriod>>()) duration_variant_data<TRep, TPeriod>(value);
     }
+}
 
-    variant_data_holder negate() const
-    {
-        variant_data_holder result(as<variant_data>());
-        result.as<variant_data>()->negate();
-
-        return result;
-    }
-
-    variant_data_holder bitwise_negate() const
-    {
-        variant_data_holder result(as<variant_data>());
-        result.as<variant_data>()->bitwise_negate();
-
-        return result;
-    }
+inline void variant_data_holder::multiply_in_place(const variant_data_holder& other) noexcept
+{
+    if (kind_ == data_kind::string)
+        return;
 
-    ~variant_data_holder()
+    if (floating_point())
     {
-        as<variant_data>()->~variant_data();
+        bool valid;
+        auto fv = other.to_float(&valid);
+        if (valid)
+        {
+            auto& value = kind_ == data_kind::floating ? float_ : fdur_.count;
+            value *= fv;
+        }
+        return;
     }
 
-    variant_data_holder& operator=(variant_data_holder&& other) noexcept
+    bool valid;
+    auto lv = other.to_integral(&valid);
+    if (valid && !other.floating_point())
     {
-        as<variant_data>()->~variant_data();
-        other.as<variant_data>()->move(std::addressof(v));
-        return *this;
+        switch (kind_)
+        {
+            case data_kind::duration:
+                dur_.count *= lv;
+                break;
+            case data_kind::unsigned_integral:
+                uint_ *= lv;
+                break;
+            default:
+                int_ *= lv;
+                break;
+        }
+        return;
     }
 
-    long long to_integral() const
-    {
-        return as<variant_data>()->to_integral(nullptr);
-    }
+    auto fv = other.to_float(&valid);
+    if (!valid)
+        return;
 
-    std::string to_string() const
+    switch (kind_)
     {
-        return as<variant_data>()->to_string();
+        case data_kind::duration:
+            dur_.count = static_cast<long long>(dur_.count * fv);
+            break;
+        case data_kind::unsigned_integral:
+            uint_ = static_cast<unsigned long long>(uint_ * fv);
+            break;
+        default:
+            int_ = static_cast<long long>(int_ * fv);
+            break;
     }
+}
 
-    long double to_float() const
-    {
-        return as<variant_data>()->to_float(nullptr);
-    }
+inline void variant_data_holder::divide_in_place(const variant_data_holder& other) noexcept
+{
+    if (kind_ == data_kind::string)
+        return;
 
-    std::chrono::nanoseconds to_nanos() const
+    if (floating_point())
     {
-        return as<variant_data>()->to_nanos(nullptr);
+        bool valid;
+        auto fv = other.to_float(&valid);
+        if (valid)
+        {
+            auto& value = kind_ == data_kind::floating ? float_ : fdur_.count;
+            if (!fv)
+                value = 0;
+            else
+                value /= fv;
+        }
+        return;
     }
 
-    int compare(const variant_data_holder& other) const
+    bool valid;
+    auto lv = other.to_integral(&valid);
+    if (valid && !other.floating_point())
     {
-        return as<variant_data>()->compare(*other.as<variant_data>());
-    }
+        if (!lv)
+        {
+            uint_ = 0;
+            if (kind_ == data_kind::duration)
+                dur_.count = 0;
+            return;
+        }
 
-    variant_data_holder add(const variant_data_holder& other) const
-    {
-        if (other.as<variant_data>()->type_score() > as<variant_data>()->type_score())
-            return other.uc_add(*this);
-        return uc_add(other);
+        switch (kind_)
+        {
+            case data_kind::duration:
+                dur_.count /= lv;
+                break;
+            case data_kind::unsigned_integral:
+                uint_ /= lv;
+                break;
+            default:
+                int_ /= lv;
+                break;
+        }
+        return;
     }
 
-    variant_data_holder multiply(const variant_data_holder& other) const
-    {
-        if (other.as<variant_data>()->type_score() > as<variant_data>()->type_score())
-            return other.uc_mult(*this);
-        return uc_mult(other);
-    }
+    auto fv = other.to_float(&valid);
+    if (!valid)
+        return;
 
-    variant_data_holder divide(const variant_data_holder& other) const
+    if (!fv)
     {
-        if (other.as<variant_data>()->type_score() > as<variant_data>()->type_score())
-            return other.uc_div(*this);
-        return uc_div(other);
+        uint_ = 0;
+        if (kind_ == data_kind::duration)
+            dur_.count = 0;
+        return;
     }
 
-    auto hash_value() const
+    switch (kind_)
     {
-        return as<variant_data>()->hash_value();
+        case data_kind::duration:
+            dur_.count = static_cast<long long>(dur_.count / fv);
+            break;
+        case data_kind::unsigned_integral:
+            uint_ = static_cast<unsigned long long>(uint_ / fv);
+            break;
+        default:
+            int_ = static_cast<long long>(int_ / fv);
+            break;
     }
-
-};
+}
 
 }
 
@@ -739,6 +841,7 @@ public:
             value_(std::move(other.value_))
     { }
 
+    metric_value& operator=(const metric_value& other) = default;
     metric_value& operator=(metric_value&& other) noexcept
     {
         value_ = std::move(other.value_);
@@ -862,6 +965,20 @@ public:
         return value_.to_string();
     }
 
+    /**
+     * \brief Call a handler with the value as it's stored, which is one of a long long, an unsigned long long, a long double, or a std::string
+     *
+     * Durations are passed as their count, the same way they're converted to strings. This lets formatters write
+     * the value out without building a string first.
+     *
+     * \param handler the handler to call with the value
+     */
+    template<typename THandler>
+    void visit(THandler&& handler) const
+    {
+        value_.visit(std::forward<THandler>(handler));
+    }
+
     template<typename TRep, typename TPer>
     operator std::chrono::nanoseconds() const
     {
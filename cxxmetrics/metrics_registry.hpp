@@ -2,16 +2,29 @@
 #define CXXMETRICS_METRICS_REGISTRY_HPP
 
 // TODO: use shared_mutexes with C++17
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <mutex>
 #include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "publisher.hpp"
 #include "tag_collection.hpp"
 #include "counter.hpp"
+#include "striped_counter.hpp"
 #include "ewma.hpp"
 #include "gauge.hpp"
 #include "histogram.hpp"
 #include "meter.hpp"
 #include "timer.hpp"
+#include "coarse_clock.hpp"
+#include "internal/metric_handle_cache.hpp"
+#include "internal/read_mostly_map.hpp"
+#include "internal/thread_stripe.hpp"
 
 namespace cxxmetrics
 {
@@ -95,10 +108,19 @@ public:
  * by their registered_metric. From there, they can publish per tagset metrics or summaries or both.
  *
  * Publishers are also able to store publisher specific data in the registered metric.
+ *
+ * A registered metric can also be given a retention policy so that tag permutations which stop being used don't
+ * pile up forever: permutations that nobody has looked up for the retention time and that nothing outside the
+ * registry holds on to get dropped when the registry is swept, and once the metric has as many permutations as
+ * it's allowed, new tag sets all go to a single permutation tagged with \refitem overflow_tags.
  */
 class basic_registered_metric
 {
     std::string type_;
+    std::atomic<std::chrono::steady_clock::rep> retention_ttl_;
+    std::atomic<std::size_t> max_permutations_;
+    // when the metric was first given a ttl and so started taking read guards on lookups, or 0 if it never has been
+    std::atomic<std::chrono::steady_clock::rep> retained_since_;
 
     std::unordered_map<std::string, std::unique_ptr<basic_publish_options>> pubdata_;
     mutable std::mutex pubdatalock_;
@@ -182,13 +204,54 @@ protected:
         }
     };
 
-    virtual void visit_each(internal::registered_snapshot_visitor_builder& builder) = 0;
+    virtual void visit_each(internal::registered_snapshot_visitor_builder& builder, std::uint64_t since) = 0;
     virtual void aggregate_all(snapshot_visitor& visitor) = 0;
     virtual std::shared_ptr<internal::metric> child(const tag_collection& tags, void* metricbuilder) = 0;
+    virtual std::size_t expire(std::chrono::steady_clock::time_point now) = 0;
+
+    std::chrono::steady_clock::rep retention_ticks() const noexcept
+    {
+        return retention_ttl_.load(std::memory_order_relaxed);
+    }
+
+    std::size_t permutation_limit() const noexcept
+    {
+        return max_permutations_.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::steady_clock::rep retained_since() const noexcept
+    {
+        return retained_since_.load(std::memory_order_acquire);
+    }
+
+    bool retains() const noexcept
+    {
+        return retained_since_.load(std::memory_order_relaxed) != 0;
+    }
+
+    /**
+     * \brief Set how long unused tag permutations are kept and how many permutations there can be
+     *
+     * This goes through metrics_registry::retention so the registry knows it has something to sweep.
+     *
+     * \param ttl how long a permutation can go without being looked up before it's dropped, or zero to keep them forever
+     * \param max_permutations the most permutations the metric will have before new tags go to the overflow permutation, or zero for no limit
+     */
+    void retention(std::chrono::steady_clock::duration ttl, std::size_t max_permutations = 0) noexcept
+    {
+        std::chrono::steady_clock::rep never = 0;
+        if (ttl.count() != 0)
+            retained_since_.compare_exchange_strong(never, std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+        retention_ttl_.store(ttl.count(), std::memory_order_relaxed);
+        max_permutations_.store(max_permutations, std::memory_order_relaxed);
+    }
 
 public:
     basic_registered_metric(const std::string& type) :
-            type_(type)
+            type_(type),
+            retention_ttl_(0),
+            max_permutations_(0),
+            retained_since_(0)
     { }
 
     virtual ~basic_registered_metric() = default;
@@ -205,9 +268,39 @@ public:
     template<typename THandler>
     void visit(THandler&& handler) {
         internal::invokable_snapshot_visitor_builder<THandler> builder(std::forward<THandler>(handler));
-        this->visit_each(builder);
+        this->visit_each(builder, 0);
     }
 
+    /**
+     * \brief Visits the metrics that changed in or after a change generation, like visit does for all of them
+     *
+     * Metrics that weren't updated since the generation aren't snapshotted at all. Gauges over functions or
+     * references can't tell when their value changes, so they're always visited, and meter and timer rates
+     * that decay between updates don't count as changes.
+     *
+     * \param since the generation from metrics_registry::next_generation, or 0 to visit every metric
+     * \param handler the instance of the handler which will be called for each of the changed metrics
+     */
+    template<typename THandler>
+    void visit_changed(std::uint64_t since, THandler&& handler) {
+        internal::invokable_snapshot_visitor_builder<THandler> builder(std::forward<THandler>(handler));
+        this->visit_each(builder, since);
+    }
+
+    /**
+     * \brief Whether any of the metrics changed in or after a change generation
+     */
+    virtual bool changed_since(std::uint64_t since) = 0;
+
+    /**
+     * \brief Snapshot every tagged permutation of the metric into snapshots that can be kept
+     *
+     * The snapshots are ready to be read from several threads at once.
+     *
+     * \param into where the tags and snapshot of each permutation are appended
+     */
+    virtual void capture(std::vector<std::pair<tag_collection, std::unique_ptr<internal::stored_snapshot>>>& into) = 0;
+
     /**
      * \brief Aggregates all of the metrics and their different tag values into a single metric
      *
@@ -227,6 +320,108 @@ public:
      * \brief Get the type of metric registered
      */
     virtual std::string type() const { return type_; }
+
+    /**
+     * \brief Get how long unused tag permutations are kept, zero meaning forever
+     */
+    std::chrono::steady_clock::duration retention_ttl() const noexcept
+    {
+        return std::chrono::steady_clock::duration(retention_ticks());
+    }
+
+    /**
+     * \brief Get the most permutations the metric will have, zero meaning no limit
+     */
+    std::size_t max_permutations() const noexcept
+    {
+        return permutation_limit();
+    }
+
+    /**
+     * \brief The tags of the permutation that new tag sets go to once a metric has reached its maximum permutations
+     */
+    static const tag_collection& overflow_tags()
+    {
+        static const tag_collection tags{{"__overflow__", "true"}};
+        return tags;
+    }
+};
+
+template<typename TMetricType>
+class registered_metric;
+
+/**
+ * \brief One metric to register in a batch: its path, its tags, and how to build it if it doesn't exist yet
+ *
+ * Metric types that can be default constructed don't need a builder. Leaving the builder out for any other type
+ * doesn't compile.
+ *
+ * \tparam TMetricType the type of metric to register
+ */
+template<typename TMetricType>
+struct metric_registration
+{
+    using metric_builder = std::function<std::shared_ptr<TMetricType>()>;
+
+    metric_path path;
+    tag_collection tags;
+    metric_builder builder;
+
+    metric_registration(metric_path name, tag_collection t, metric_builder b) :
+            path(std::move(name)),
+            tags(std::move(t)),
+            builder(std::move(b))
+    { }
+
+    template<typename T = TMetricType, typename = typename std::enable_if<std::is_default_constructible<T>::value, void>::type>
+    metric_registration(metric_path name, tag_collection t = tag_collection()) :
+            path(std::move(name)),
+            tags(std::move(t)),
+            builder([]() { return std::make_shared<T>(); })
+    { }
+};
+
+/**
+ * \brief A metric path and set of tags that have been resolved in a registry
+ *
+ * The key points at the registered metric and carries the tags along with their hash, so looking the metric up
+ * again through the key doesn't hash any strings. The tags are kept by value because the permutation they name
+ * may be dropped from the registry and added back later.
+ */
+class metric_key
+{
+    basic_registered_metric* metric_;
+    tag_collection tags_;
+    std::size_t hash_;
+
+    metric_key(basic_registered_metric* metric, const tag_collection& tags, std::size_t hash) :
+            metric_(metric),
+            tags_(tags),
+            hash_(hash)
+    { }
+
+    template<typename TMetricType>
+    friend class registered_metric;
+public:
+    metric_key() noexcept :
+            metric_(nullptr),
+            hash_(0)
+    { }
+
+    /**
+     * \brief Get the registered metric the key belongs to
+     */
+    basic_registered_metric* registered() const noexcept { return metric_; }
+
+    /**
+     * \brief Get the tags of the key
+     */
+    const tag_collection& tags() const noexcept { return tags_; }
+
+    /**
+     * \brief Get the precomputed hash of the tags
+     */
+    std::size_t hash() const noexcept { return hash_; }
 };
 
 /**
@@ -237,31 +432,239 @@ public:
 template<typename TMetricType>
 class registered_metric : public basic_registered_metric
 {
-    std::unordered_map<tag_collection, std::shared_ptr<TMetricType>> metrics_;
-    std::mutex lock_;
+    struct permutation
+    {
+        std::shared_ptr<TMetricType> metric;
+        // when the permutation was last looked up in coarse clock ticks, or 0 if it hasn't been stamped yet
+        std::atomic<std::chrono::steady_clock::rep> touched;
+
+        permutation(std::shared_ptr<TMetricType>&& m) noexcept :
+                metric(std::move(m)),
+                touched(0)
+        { }
+
+        permutation(permutation&& other) noexcept :
+                metric(std::move(other.metric)),
+                touched(other.touched.load(std::memory_order_relaxed))
+        { }
+    };
+
+    // finding an existing tagged metric doesn't lock, only adding or dropping one does
+    internal::read_mostly_map<tag_collection, permutation> metrics_;
+
+    void touch(permutation& p) noexcept;
+
+    template<typename TBuilder>
+    std::shared_ptr<TMetricType> get_or_add(const tag_collection& tags, std::size_t hash, TBuilder&& builder);
+
+    std::vector<std::pair<tag_collection, std::shared_ptr<TMetricType>>> permutations(std::uint64_t since);
 
 protected:
-    void visit_each(internal::registered_snapshot_visitor_builder& builder) override;
+    void visit_each(internal::registered_snapshot_visitor_builder& builder, std::uint64_t since) override;
     void aggregate_all(snapshot_visitor& visitor) override;
     std::shared_ptr<internal::metric> child(const tag_collection& tags, void* metricbuilder) override;
+    std::size_t expire(std::chrono::steady_clock::time_point now) override;
 
 public:
+    using metric_builder = std::function<std::shared_ptr<TMetricType>()>;
+
     registered_metric(const std::string& metric_type_name) :
             basic_registered_metric(metric_type_name)
     { }
+
+    bool changed_since(std::uint64_t since) override;
+    void capture(std::vector<std::pair<tag_collection, std::unique_ptr<internal::stored_snapshot>>>& into) override;
+
+    /**
+     * \brief Resolve a set of tags into a key, building the tagged metric if it doesn't exist yet
+     */
+    metric_key bind(const tag_collection& tags, const metric_builder& builder);
+
+    /**
+     * \brief Get the tagged metric for a key, building it if it doesn't exist
+     */
+    std::shared_ptr<TMetricType> find(const metric_key& key, const metric_builder& builder);
+
+    /**
+     * \brief Get or build the tagged metrics for part of a batch of registrations, taking the lock once
+     *
+     * \param entries the registrations in the batch
+     * \param which the indexes of the entries that belong to this metric
+     * \param result where the metric for each of the entries is stored, at the entry's index
+     */
+    void add_all(const std::vector<metric_registration<TMetricType>>& entries, const std::vector<std::size_t>& which,
+            std::vector<std::shared_ptr<TMetricType>>& result);
 };
 
 template<typename TMetricType>
-void registered_metric<TMetricType>::visit_each(cxxmetrics::internal::registered_snapshot_visitor_builder &builder)
+void registered_metric<TMetricType>::touch(permutation& p) noexcept
 {
-    std::lock_guard<std::mutex> lock(lock_);
-    for (auto& p : metrics_)
+    auto ttl = retention_ticks();
+    if (ttl == 0)
+        return;
+
+    // only write the stamp when it's gone stale by an eighth of the ttl so busy permutations aren't written constantly
+    auto now = coarse_clock::now().time_since_epoch().count();
+    if (now - p.touched.load(std::memory_order_relaxed) >= ttl / 8)
+        p.touched.store(now, std::memory_order_relaxed);
+}
+
+template<typename TMetricType>
+template<typename TBuilder>
+std::shared_ptr<TMetricType> registered_metric<TMetricType>::get_or_add(const tag_collection& tags, std::size_t hash, TBuilder&& builder)
+{
+    // nothing is ever dropped from a metric that's never had a ttl, so its lookups can skip the read guard
+    auto retaining = retains();
+    internal::read_mostly_guard guard(retaining);
+
+    auto res = metrics_.find(tags, hash);
+    if (res != nullptr)
     {
-        auto sz = builder.visitor_size() + sizeof(std::max_align_t);
-        void* ptr = alloca(sz);
+        auto metric = res->metric;
 
-        std::align(sizeof(std::max_align_t), sz, ptr, sz);
-        auto loc = reinterpret_cast<snapshot_visitor*>(ptr);
+        // a sweep can only drop the permutation if it didn't count our copy, in which case it marked the metric first
+        if (!retaining || !metric->retired())
+        {
+            touch(*res);
+            return metric;
+        }
+    }
+
+    // the limit is checked with the lock held so first lookups racing each other can't all get in under it
+    typename decltype(metrics_)::batch batch(metrics_);
+    auto limit = permutation_limit();
+    if (limit != 0 && metrics_.size() >= limit && tags != overflow_tags() && metrics_.find(tags, hash) == nullptr)
+    {
+        auto& overflow = overflow_tags();
+        res = batch.get_or_add_entry(overflow, overflow.hash(), std::forward<TBuilder>(builder)).second;
+    }
+    else
+        res = batch.get_or_add_entry(tags, hash, std::forward<TBuilder>(builder)).second;
+
+    // sweeps hold the lock while they decide, so whatever's in the map now stays there while it's copied
+    touch(*res);
+    return res->metric;
+}
+
+template<typename TMetricType>
+metric_key registered_metric<TMetricType>::bind(const tag_collection& tags, const metric_builder& builder)
+{
+    auto hash = metrics_.hash(tags);
+    get_or_add(tags, hash, builder);
+
+    return metric_key(this, tags, hash);
+}
+
+template<typename TMetricType>
+std::shared_ptr<TMetricType> registered_metric<TMetricType>::find(const metric_key& key, const metric_builder& builder)
+{
+    return get_or_add(key.tags_, key.hash_, builder);
+}
+
+template<typename TMetricType>
+void registered_metric<TMetricType>::add_all(const std::vector<metric_registration<TMetricType>>& entries, const std::vector<std::size_t>& which,
+        std::vector<std::shared_ptr<TMetricType>>& result)
+{
+    // nothing can be removed while the batch holds the lock, so there's no need for a read guard
+    typename decltype(metrics_)::batch batch(metrics_);
+    auto limit = permutation_limit();
+    batch.reserve(limit != 0 ? std::min(which.size(), limit) : which.size());
+
+    for (auto i : which)
+    {
+        auto& entry = entries[i];
+        auto hash = entry.tags.hash();
+        auto res = metrics_.find(entry.tags, hash);
+        if (res == nullptr)
+        {
+            if (limit != 0 && metrics_.size() >= limit && entry.tags != overflow_tags())
+                res = batch.get_or_add_entry(overflow_tags(), overflow_tags().hash(), entry.builder).second;
+            else
+                res = batch.get_or_add_entry(entry.tags, hash, entry.builder).second;
+        }
+
+        touch(*res);
+        result[i] = res->metric;
+    }
+}
+
+/**
+ * \brief A reference to a tagged metric in a registry that's cheap to look up over and over
+ *
+ * Use this where the metric's shared_ptr can't be kept around. Getting the metric goes through the
+ * precomputed key instead of hashing the path and the tags again.
+ *
+ * \tparam TMetricType the type of the metric
+ */
+template<typename TMetricType>
+class bound_metric_ref
+{
+    metric_key key_;
+    typename registered_metric<TMetricType>::metric_builder builder_;
+public:
+    bound_metric_ref(const metric_key& key, typename registered_metric<TMetricType>::metric_builder builder) :
+            key_(key),
+            builder_(std::move(builder))
+    { }
+
+    /**
+     * \brief Get the key the reference looks the metric up by
+     */
+    const metric_key& key() const noexcept { return key_; }
+
+    /**
+     * \brief Get the referenced metric
+     */
+    std::shared_ptr<TMetricType> get() const
+    {
+        return static_cast<registered_metric<TMetricType>*>(key_.registered())->find(key_, builder_);
+    }
+
+    std::shared_ptr<TMetricType> operator->() const
+    {
+        return get();
+    }
+};
+
+template<typename TMetricType>
+std::vector<std::pair<tag_collection, std::shared_ptr<TMetricType>>> registered_metric<TMetricType>::permutations(std::uint64_t since)
+{
+    std::vector<std::pair<tag_collection, std::shared_ptr<TMetricType>>> metrics;
+    internal::read_mostly_guard guard;
+    metrics.reserve(since == 0 ? metrics_.size() : 0);
+    metrics_.each([&metrics, since](const tag_collection& tags, const permutation& p) {
+        if (since == 0 || p.metric->changed_generation() >= since)
+            metrics.emplace_back(tags, p.metric);
+    });
+
+    return metrics;
+}
+
+template<typename TMetricType>
+void registered_metric<TMetricType>::capture(std::vector<std::pair<tag_collection, std::unique_ptr<internal::stored_snapshot>>>& into)
+{
+    auto metrics = permutations(0);
+    into.reserve(into.size() + metrics.size());
+    for (auto& p : metrics)
+    {
+        using snapshot_type = decltype(p.second->snapshot());
+        into.emplace_back(std::move(p.first), std::make_unique<internal::typed_stored_snapshot<snapshot_type>>(p.second->snapshot()));
+    }
+}
+
+template<typename TMetricType>
+void registered_metric<TMetricType>::visit_each(cxxmetrics::internal::registered_snapshot_visitor_builder &builder, std::uint64_t since)
+{
+    // collect the permutations first so snapshotting and visiting work on a stable list
+    auto metrics = permutations(since);
+
+    auto sz = builder.visitor_size() + sizeof(std::max_align_t);
+    void* ptr = alloca(sz);
+    std::align(sizeof(std::max_align_t), sz, ptr, sz);
+    auto loc = reinterpret_cast<snapshot_visitor*>(ptr);
+
+    for (auto& p : metrics)
+    {
         builder.construct(loc, p.first);
         try
         {
@@ -277,36 +680,82 @@ void registered_metric<TMetricType>::visit_each(cxxmetrics::internal::registered
     }
 }
 
+template<typename TMetricType>
+bool registered_metric<TMetricType>::changed_since(std::uint64_t since)
+{
+    internal::read_mostly_guard guard;
+    return metrics_.any([since](const tag_collection&, const permutation& p) {
+        return p.metric->changed_generation() >= since;
+    });
+}
+
 template<typename TMetricType>
 void registered_metric<TMetricType>::aggregate_all(snapshot_visitor &visitor)
 {
-    std::unique_lock<std::mutex> lock(lock_);
+    std::vector<std::shared_ptr<TMetricType>> metrics;
+    {
+        internal::read_mostly_guard guard;
+        metrics.reserve(metrics_.size());
+        metrics_.each([&metrics](const tag_collection&, const permutation& p) {
+            metrics.push_back(p.metric);
+        });
+    }
 
-    auto itr = metrics_.begin();
-    if (itr == metrics_.end())
+    auto itr = metrics.begin();
+    if (itr == metrics.end())
         return;
 
-    auto result = itr->second->snapshot();
-    for (++itr; itr != metrics_.end(); ++itr)
+    auto result = (*itr)->snapshot();
+    for (++itr; itr != metrics.end(); ++itr)
     {
-        result.merge(itr->second->snapshot());
+        result.merge((*itr)->snapshot());
     }
 
-    lock.unlock();
     visitor.visit(result);
 }
 
 template<typename TMetricType>
 std::shared_ptr<internal::metric> registered_metric<TMetricType>::child(const cxxmetrics::tag_collection &tags, void* metricbuilder)
 {
-    std::lock_guard<std::mutex> lock(lock_);
-    auto res = metrics_.find(tags);
+    return std::static_pointer_cast<internal::metric>(get_or_add(tags, tags.hash(), [metricbuilder]() {
+        return static_cast<basic_metric_builder<TMetricType>*>(metricbuilder)->build();
+    }));
+}
+
+template<typename TMetricType>
+std::size_t registered_metric<TMetricType>::expire(std::chrono::steady_clock::time_point now)
+{
+    auto ttl = retention_ticks();
+    auto since = retained_since();
+    if (ttl == 0 || since == 0)
+        return 0;
+
+    // lookups that started before the metric had a ttl didn't take a read guard, so give them time to finish
+    auto at = now.time_since_epoch().count();
+    if (at - since < std::chrono::steady_clock::duration(std::chrono::seconds(1)).count())
+        return 0;
+
+    return metrics_.remove_if([at, ttl](const tag_collection&, permutation& p) {
+        auto touched = p.touched.load(std::memory_order_relaxed);
+        if (touched == 0)
+        {
+            // added before there was a retention policy, so start its clock now
+            p.touched.store(at, std::memory_order_relaxed);
+            return false;
+        }
 
-    if (res != metrics_.end())
-        return std::static_pointer_cast<internal::metric>(res->second);
+        if (at - touched < ttl)
+            return false;
 
-    return std::static_pointer_cast<internal::metric>(
-            metrics_.emplace(tags, static_cast<basic_metric_builder<TMetricType>*>(metricbuilder)->build()).first->second);
+        // anything still holding on to the metric would keep updating it after it was dropped, including a lookup
+        // that found the permutation just before now and is copying it, which is why it's marked before counting
+        p.metric->retire();
+        if (p.metric.use_count() == 1)
+            return true;
+
+        p.metric->revive();
+        return false;
+    });
 }
 
 /**
@@ -326,6 +775,8 @@ public:
 
     template<typename TMetricPtrBuilder>
     basic_registered_metric& get_or_add(const metric_path& name, const TMetricPtrBuilder& builder);
+    template<typename TMetricPtrBuilder>
+    void get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result);
     basic_registered_metric* get(const metric_path& name);
 
     template<typename THandler>
@@ -356,6 +807,24 @@ basic_registered_metric& basic_default_repository<TAlloc>::get_or_add(const metr
     return *existing->second;
 }
 
+template<typename TAlloc>
+template<typename TMetricPtrBuilder>
+void basic_default_repository<TAlloc>::get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result)
+{
+    result.resize(names.size());
+
+    std::lock_guard<std::mutex> lock(metriclock_);
+    metrics_.reserve(metrics_.size() + names.size());
+    for (std::size_t i = 0; i < names.size(); i++)
+    {
+        auto existing = metrics_.find(names[i]);
+        if (existing == metrics_.end())
+            existing = metrics_.emplace(names[i], builder()).first;
+
+        result[i] = existing->second.get();
+    }
+}
+
 template<typename TAlloc>
 basic_registered_metric* basic_default_repository<TAlloc>::get(const metric_path& name)
 {
@@ -372,9 +841,17 @@ template<typename TAlloc>
 template<typename THandler>
 void basic_default_repository<TAlloc>::visit(THandler&& handler)
 {
-    std::lock_guard<std::mutex> lock(metriclock_);
-    for (auto& pair : metrics_)
-        handler(pair.first, *pair.second);
+    // registered metrics are never removed, so the pointers stay good after the lock is released
+    std::vector<std::pair<const metric_path*, basic_registered_metric*>> metrics;
+    {
+        std::lock_guard<std::mutex> lock(metriclock_);
+        metrics.reserve(metrics_.size());
+        for (auto& pair : metrics_)
+            metrics.emplace_back(&pair.first, pair.second.get());
+    }
+
+    for (auto& pair : metrics)
+        handler(*pair.first, *pair.second);
 }
 
 template<typename TAlloc>
@@ -408,6 +885,265 @@ basic_default_repository<TAlloc>::get_publish_data() const
 
 using default_repository = basic_default_repository<std::allocator<std::pair<metric_path, basic_registered_metric>>>;
 
+/**
+ * \brief A metric repository where finding an already registered metric never takes a lock
+ *
+ * Registering a new metric path still takes a lock, but looking up the ones that exist, which is nearly every
+ * call to the registry, is a hash and a few atomic loads. Metrics are never unregistered.
+ */
+class read_mostly_repository
+{
+    internal::read_mostly_map<metric_path, std::unique_ptr<basic_registered_metric>> metrics_;
+    std::unordered_map<std::string, std::unique_ptr<basic_publish_options>> data_;
+
+    mutable std::mutex datalock_;
+
+public:
+    read_mostly_repository() = default;
+
+    template<typename TMetricPtrBuilder>
+    basic_registered_metric& get_or_add(const metric_path& name, const TMetricPtrBuilder& builder);
+    template<typename TMetricPtrBuilder>
+    void get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result);
+    basic_registered_metric* get(const metric_path& name);
+
+    template<typename THandler>
+    void visit(THandler&& handler);
+
+    constexpr const tag_collection& tags(const tag_collection& tags) const noexcept { return tags; }
+
+    template<typename TDataType, typename... TConstructArgs>
+    typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type& get_publish_data(TConstructArgs&&... args);
+
+    template<typename TDataType>
+    typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type* get_publish_data() const;
+};
+
+template<typename TMetricPtrBuilder>
+basic_registered_metric& read_mostly_repository::get_or_add(const metric_path& name, const TMetricPtrBuilder& builder)
+{
+    auto existing = metrics_.find(name);
+    if (existing != nullptr)
+        return **existing;
+
+    return *metrics_.get_or_add(name, builder);
+}
+
+template<typename TMetricPtrBuilder>
+void read_mostly_repository::get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result)
+{
+    result.resize(names.size());
+
+    decltype(metrics_)::batch batch(metrics_);
+    batch.reserve(names.size());
+    for (std::size_t i = 0; i < names.size(); i++)
+        result[i] = batch.get_or_add_entry(names[i], metrics_.hash(names[i]), builder).second->get();
+}
+
+inline basic_registered_metric* read_mostly_repository::get(const metric_path& name)
+{
+    auto existing = metrics_.find(name);
+    if (existing == nullptr)
+        return nullptr;
+
+    return existing->get();
+}
+
+template<typename THandler>
+void read_mostly_repository::visit(THandler&& handler)
+{
+    metrics_.each([&handler](const metric_path& path, const std::unique_ptr<basic_registered_metric>& metric) {
+        handler(path, *metric);
+    });
+}
+
+template<typename TDataType, typename... TConstructArgs>
+typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type&
+read_mostly_repository::get_publish_data(TConstructArgs&&... args)
+{
+    std::lock_guard<std::mutex> lock(datalock_);
+    auto& ptr = data_[ctti::nameof<TDataType>().str()];
+
+    if (!ptr)
+        ptr = std::make_unique<TDataType>(std::forward<TConstructArgs>(args)...);
+
+    return static_cast<TDataType&>(*ptr);
+}
+
+template<typename TDataType>
+typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type*
+read_mostly_repository::get_publish_data() const
+{
+    std::lock_guard<std::mutex> lock(datalock_);
+    auto fnd = data_.find(ctti::nameof<TDataType>().str());
+    if (fnd == data_.end())
+        return nullptr;
+
+    return static_cast<TDataType*>(fnd->second.get());
+}
+
+/**
+ * \brief A metric repository that splits the metric paths into shards by their hash
+ *
+ * Each shard has its own reader/writer lock, so registering a metric only blocks lookups that land in the same
+ * shard. Visiting copies one shard's metrics at a time under a shared lock and then calls the handler without
+ * holding any locks, so publishing doesn't hold up registering metrics.
+ *
+ * \tparam NShards the number of shards to split the metric paths into
+ */
+template<std::size_t NShards = 16>
+class sharded_repository
+{
+    static_assert(NShards > 0, "sharded_repository needs at least one shard");
+
+    struct alignas(internal::cache_line_size) shard
+    {
+        std::unordered_map<metric_path, std::unique_ptr<basic_registered_metric>> metrics;
+        mutable std::shared_timed_mutex lock;
+    };
+
+    shard shards_[NShards];
+    std::unordered_map<std::string, std::unique_ptr<basic_publish_options>> data_;
+
+    mutable std::mutex datalock_;
+
+    shard& shard_for(const metric_path& name) noexcept
+    {
+        return shards_[std::hash<metric_path>()(name) % NShards];
+    }
+
+public:
+    sharded_repository() = default;
+
+    template<typename TMetricPtrBuilder>
+    basic_registered_metric& get_or_add(const metric_path& name, const TMetricPtrBuilder& builder);
+    template<typename TMetricPtrBuilder>
+    void get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result);
+    basic_registered_metric* get(const metric_path& name);
+
+    template<typename THandler>
+    void visit(THandler&& handler);
+
+    constexpr const tag_collection& tags(const tag_collection& tags) const noexcept { return tags; }
+
+    template<typename TDataType, typename... TConstructArgs>
+    typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type& get_publish_data(TConstructArgs&&... args);
+
+    template<typename TDataType>
+    typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type* get_publish_data() const;
+};
+
+template<std::size_t NShards>
+template<typename TMetricPtrBuilder>
+basic_registered_metric& sharded_repository<NShards>::get_or_add(const metric_path& name, const TMetricPtrBuilder& builder)
+{
+    auto& s = shard_for(name);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(s.lock);
+        auto existing = s.metrics.find(name);
+        if (existing != s.metrics.end())
+            return *existing->second;
+    }
+
+    std::lock_guard<std::shared_timed_mutex> lock(s.lock);
+    auto existing = s.metrics.find(name);
+    if (existing != s.metrics.end())
+        return *existing->second;
+
+    return *s.metrics.emplace(name, builder()).first->second;
+}
+
+template<std::size_t NShards>
+template<typename TMetricPtrBuilder>
+void sharded_repository<NShards>::get_or_add_all(const std::vector<metric_path>& names, const TMetricPtrBuilder& builder, std::vector<basic_registered_metric*>& result)
+{
+    result.resize(names.size());
+
+    // sort the names out by shard first so each shard is only locked once
+    std::vector<std::size_t> byshard[NShards];
+    for (std::size_t i = 0; i < names.size(); i++)
+        byshard[std::hash<metric_path>()(names[i]) % NShards].push_back(i);
+
+    for (std::size_t sh = 0; sh < NShards; sh++)
+    {
+        if (byshard[sh].empty())
+            continue;
+
+        auto& s = shards_[sh];
+        std::lock_guard<std::shared_timed_mutex> lock(s.lock);
+        s.metrics.reserve(s.metrics.size() + byshard[sh].size());
+        for (auto i : byshard[sh])
+        {
+            auto existing = s.metrics.find(names[i]);
+            if (existing == s.metrics.end())
+                existing = s.metrics.emplace(names[i], builder()).first;
+
+            result[i] = existing->second.get();
+        }
+    }
+}
+
+template<std::size_t NShards>
+basic_registered_metric* sharded_repository<NShards>::get(const metric_path& name)
+{
+    auto& s = shard_for(name);
+    std::shared_lock<std::shared_timed_mutex> lock(s.lock);
+    auto existing = s.metrics.find(name);
+
+    if (existing == s.metrics.end())
+        return nullptr;
+
+    return existing->second.get();
+}
+
+template<std::size_t NShards>
+template<typename THandler>
+void sharded_repository<NShards>::visit(THandler&& handler)
+{
+    // registered metrics are never removed, so the pointers stay good after the lock is released
+    std::vector<std::pair<const metric_path*, basic_registered_metric*>> metrics;
+    for (auto& s : shards_)
+    {
+        metrics.clear();
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(s.lock);
+            metrics.reserve(s.metrics.size());
+            for (auto& pair : s.metrics)
+                metrics.emplace_back(&pair.first, pair.second.get());
+        }
+
+        for (auto& pair : metrics)
+            handler(*pair.first, *pair.second);
+    }
+}
+
+template<std::size_t NShards>
+template<typename TDataType, typename... TConstructArgs>
+typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type&
+sharded_repository<NShards>::get_publish_data(TConstructArgs&&... args)
+{
+    std::lock_guard<std::mutex> lock(datalock_);
+    auto& ptr = data_[ctti::nameof<TDataType>().str()];
+
+    if (!ptr)
+        ptr = std::make_unique<TDataType>(std::forward<TConstructArgs>(args)...);
+
+    return static_cast<TDataType&>(*ptr);
+}
+
+template<std::size_t NShards>
+template<typename TDataType>
+typename std::enable_if<std::is_base_of<basic_publish_options, TDataType>::value, TDataType>::type*
+sharded_repository<NShards>::get_publish_data() const
+{
+    std::lock_guard<std::mutex> lock(datalock_);
+    auto fnd = data_.find(ctti::nameof<TDataType>().str());
+    if (fnd == data_.end())
+        return nullptr;
+
+    return static_cast<TDataType*>(fnd->second.get());
+}
+
 /**
  * \brief The registry where metrics are registered
  *
@@ -417,6 +1153,12 @@ template<typename TRepository = default_repository>
 class metrics_registry
 {
     TRepository repo_;
+    std::uint64_t id_;
+    // bumped whenever a sweep drops permutations so cached lookups know to look again
+    std::atomic<std::uint64_t> epoch_;
+    std::atomic<bool> cache_lookups_;
+    // set once any metric has been given a ttl, since there's nothing to sweep until then
+    std::atomic<bool> retains_;
 
     template<typename TMetricType>
     registered_metric<TMetricType>& get(const metric_path& path);
@@ -441,7 +1183,11 @@ public:
 
     metrics_registry(const metrics_registry&) = default;
     metrics_registry(metrics_registry&& other) noexcept :
-            repo_(std::move(other.repo_))
+            repo_(std::move(other.repo_)),
+            id_(internal::metric_handle_cache::next_registry_id()),
+            epoch_(0),
+            cache_lookups_(other.cache_lookups_.load()),
+            retains_(other.retains_.load())
     { }
     ~metrics_registry() = default;
 
@@ -469,6 +1215,55 @@ public:
      */
     void publish_options(const metric_path& name, cxxmetrics::publish_options&& options);
 
+    /**
+     * \brief Set the retention policy for the tag permutations of a single metric
+     *
+     * if the metric provided isn't registered, this method does nothing
+     *
+     * \param name the metric on which to set the policy
+     * \param ttl how long a permutation can go without being looked up before it's dropped, or zero to keep them forever
+     * \param max_permutations the most permutations the metric will have before new tags go to the overflow permutation, or zero for no limit
+     */
+    void retention(const metric_path& name, std::chrono::steady_clock::duration ttl, std::size_t max_permutations = 0);
+
+    /**
+     * \brief Drop the tag permutations that have outlived their metric's retention policy
+     *
+     * Publishers sweep the registry every time they visit it, but anything else can call this too, such as a
+     * background thread for a registry that isn't published often.
+     *
+     * Until a metric in the registry has been given a ttl, sweeping returns straight away.
+     *
+     * \param now the time to measure how long permutations have been unused against
+     *
+     * \return the number of permutations dropped
+     */
+    std::size_t sweep(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /**
+     * \brief Turn the per-thread lookup cache on or off
+     *
+     * With the cache on, each thread remembers the last metrics it looked up by path and tags in a small fixed size
+     * table, so looking the same metric up over and over doesn't go through the repository at all. This is worth it
+     * for code that looks metrics up inline on every call rather than keeping them around. The cache never keeps a
+     * permutation from being swept, and it's invalidated whenever a sweep drops something. Turning it on starts the
+     * coarse clock, which the cache uses to decide when entries need to be looked up again.
+     *
+     * \param enabled whether lookups go through the cache
+     */
+    void cache_lookups(bool enabled) noexcept
+    {
+        cache_lookups_.store(enabled, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Get whether lookups go through the per-thread lookup cache
+     */
+    bool cache_lookups() const noexcept
+    {
+        return cache_lookups_.load(std::memory_order_relaxed);
+    }
+
     /**
      *  \brief Run a visitor on all of the registered metrics
      *
@@ -486,6 +1281,20 @@ public:
     template<typename THandler>
     void visit_registered_metrics(THandler&& handler);
 
+    /**
+     * \brief Start a new change generation for publishers that only publish what changed
+     *
+     * Every update to a metric stamps it with the current generation, so visiting the metrics changed since the
+     * returned generation later on finds everything updated after this call. The generation is shared by every
+     * registry in the process, so publishers don't get in each other's way by starting new ones.
+     *
+     * \return the generation to visit changes since the next time
+     */
+    std::uint64_t next_generation() noexcept
+    {
+        return internal::change_generation::advance();
+    }
+
     /**
      * \brief Register an existing metric in the registry (perhaps one obtained from another registry)
      *
@@ -502,6 +1311,41 @@ public:
     template<typename TMetric>
     bool register_existing(const metric_path& name, std::shared_ptr<TMetric> metric, const tag_collection& tags = tag_collection());
 
+    /**
+     * \brief Get or register many metrics of the same type at once, such as every permutation of a metric family at startup
+     *
+     * The new paths are added to the repository in one pass, with room reserved for all of them up front, and
+     * each registered metric then adds all of its new tag permutations in one pass as well. That saves taking the
+     * locks and growing the tables over and over as happens when registering the metrics one at a time.
+     *
+     * \throws metric_type_mismatch if one of the paths is already registered as a different type of metric, in which
+     * case the paths in the batch may be registered but none of the tagged metrics are
+     *
+     * \tparam TMetricType the type of metrics to register
+     *
+     * \param entries the paths, tags, and builders of the metrics to register
+     *
+     * \return the metric for each of the entries, in the same order
+     */
+    template<typename TMetricType>
+    std::vector<std::shared_ptr<TMetricType>> register_batch(const std::vector<metric_registration<TMetricType>>& entries);
+
+    /**
+     * \brief Resolve a metric path and tags once, getting a reference that can look the metric up cheaply after that
+     *
+     * \throws metric_type_mismatch if there is already a registered metric at the path of a different type
+     *
+     * \tparam TMetricType the type of the metric to bind
+     *
+     * \param name the name of the metric
+     * \param tags the tags for the permutation being bound
+     * \param args the arguments to construct the metric with if it doesn't exist yet (they're copied into the reference)
+     *
+     * \return a reference to the metric at the path with the tags specified
+     */
+    template<typename TMetricType, typename... TConstructorArgs>
+    bound_metric_ref<TMetricType> bind(const metric_path& name, const tag_collection& tags, TConstructorArgs&&... args);
+
     /**
      * \brief Get the registered counter or register a new one with the given path and tags
      *
@@ -527,6 +1371,35 @@ public:
         return this->template counter<TCount>(name, 0, tags);
     }
 
+    /**
+     * \brief Get the registered striped counter or register a new one with the given path and tags
+     *
+     * A striped counter spreads increments across cache line padded cells and only sums them when read.
+     * It's a better fit than counter for counters that are incremented from many threads at once.
+     *
+     * \throws metric_type_mismatch if there is already a registered metric at the path of a different type
+     *
+     * \tparam TCount the type of counter
+     * \tparam TStripes the number of cells the counter spreads increments over
+     *
+     * \param name the name of the metric to get
+     * \param initialValue the initial value for the counter (ignored if counter already exists)
+     * \param tags the tags for the permutation being sought
+     *
+     * \return the striped counter at the path specified with the tags specified
+     */
+    template<typename TCount = int64_t, std::size_t TStripes = 16>
+    std::shared_ptr<cxxmetrics::striped_counter<TCount, TStripes>> striped_counter(const metric_path& name, TCount&& initialValue, const tag_collection& tags = tag_collection());
+
+    /**
+     * \brief Another overload for getting a striped counter without an initial value
+     */
+    template<typename TCount = int64_t, std::size_t TStripes = 16>
+    std::shared_ptr<cxxmetrics::striped_counter<TCount, TStripes>> striped_counter(const metric_path& name, const tag_collection& tags = tag_collection())
+    {
+        return this->template striped_counter<TCount, TStripes>(name, 0, tags);
+    }
+
     /**
      * \brief Get the registered exponential moving average or register a new one with the given path and tags
      *
@@ -569,6 +1442,9 @@ public:
     /**
      * \brief Get the registered histogram or register a new one with the given path and tags
      *
+     * Every tagged permutation gets its own copy of the reservoir, so reservoirs that keep a lot of state cost that
+     * much for each permutation. An hdr_reservoir with the default range and precision is about 270KB.
+     *
      * \throws metric_type_mismatch if there is already a registered metric at the path of a different type, including a different reservoir
      *
      * \tparam TReservoir the reservoir type
@@ -647,7 +1523,11 @@ public:
 template<typename TRepository>
 template<typename... TRepoArgs>
 metrics_registry<TRepository>::metrics_registry(TRepoArgs &&... args) :
-        repo_(std::forward<TRepoArgs>(args)...)
+        repo_(std::forward<TRepoArgs>(args)...),
+        id_(internal::metric_handle_cache::next_registry_id()),
+        epoch_(0),
+        cache_lookups_(false),
+        retains_(false)
 { }
 
 template<typename TRepository>
@@ -677,6 +1557,38 @@ void metrics_registry<TRepository>::publish_options(const metric_path& path, cxx
     l->template get_or_create_publish_data<cxxmetrics::publish_options>() = std::move(options);
 }
 
+template<typename TRepository>
+void metrics_registry<TRepository>::retention(const metric_path& path, std::chrono::steady_clock::duration ttl, std::size_t max_permutations)
+{
+    auto l = try_get(path);
+    if (l == nullptr)
+        return;
+
+    l->retention(ttl, max_permutations);
+    if (ttl.count() != 0)
+        retains_.store(true, std::memory_order_relaxed);
+
+    // cached lookups were timed for the old policy
+    epoch_.fetch_add(1, std::memory_order_release);
+}
+
+template<typename TRepository>
+std::size_t metrics_registry<TRepository>::sweep(std::chrono::steady_clock::time_point now)
+{
+    if (!retains_.load(std::memory_order_relaxed))
+        return 0;
+
+    std::size_t dropped = 0;
+    repo_.visit([&dropped, now](const metric_path&, basic_registered_metric& metric) {
+        dropped += metric.expire(now);
+    });
+
+    if (dropped > 0)
+        epoch_.fetch_add(1, std::memory_order_release);
+
+    return dropped;
+}
+
 template<typename TRepository>
 template<typename TMetricType>
 registered_metric<TMetricType>& metrics_registry<TRepository>::get(const metric_path& path)
@@ -694,8 +1606,32 @@ template<typename TRepository>
 template<typename TMetricType, typename... TConstructorArgs>
 std::shared_ptr<TMetricType> metrics_registry<TRepository>::get(const metric_path& path, const tag_collection& tags, TConstructorArgs&&... args)
 {
+    if (!cache_lookups_.load(std::memory_order_relaxed))
+    {
+        auto& r = get<TMetricType>(path);
+        return r.template tagged<TMetricType>(repo_.tags(tags), std::forward<TConstructorArgs>(args)...);
+    }
+
+    // the address of a static that's unique to the metric type identifies the type in the cache
+    static const char type_tag = 0;
+    auto& cache = internal::metric_handle_cache::local();
+    auto epoch = epoch_.load(std::memory_order_acquire);
+    auto now = coarse_clock::now().time_since_epoch().count();
+    auto cached = cache.find(id_, epoch, &type_tag, path, tags, now);
+
+    // the cache doesn't keep the metric alive, so a sweep dropping it can race the cache taking a copy, same as a lookup
+    if (cached && !cached->retired())
+        return std::static_pointer_cast<TMetricType>(cached);
+
     auto& r = get<TMetricType>(path);
-    return r.template tagged<TMetricType>(repo_.tags(tags), std::forward<TConstructorArgs>(args)...);
+    auto result = r.template tagged<TMetricType>(repo_.tags(tags), std::forward<TConstructorArgs>(args)...);
+
+    // come back through the registry often enough that the permutation never looks unused
+    auto ttl = r.retention_ticks();
+    auto refresh = ttl ? ttl / 8 : std::chrono::steady_clock::duration(std::chrono::seconds(1)).count();
+    cache.store(id_, epoch, &type_tag, path, tags, result, now + refresh);
+
+    return result;
 }
 
 template<typename TRepository>
@@ -721,6 +1657,56 @@ bool metrics_registry<TRepository>::register_existing(const metric_path& name,
     return l.template add_existing<TMetric>(repo_.tags(tags), std::move(metric));
 }
 
+template<typename TRepository>
+template<typename TMetricType>
+std::vector<std::shared_ptr<TMetricType>> metrics_registry<TRepository>::register_batch(const std::vector<metric_registration<TMetricType>>& entries)
+{
+    static const std::string mtype = internal::metric_default_value<TMetricType>().metric_type();
+
+    // group the entries by path so each path is looked up once
+    std::vector<metric_path> names;
+    std::vector<std::vector<std::size_t>> members;
+    std::unordered_map<metric_path, std::size_t> indexes;
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        auto inserted = indexes.emplace(entries[i].path, names.size());
+        if (inserted.second)
+        {
+            names.push_back(entries[i].path);
+            members.emplace_back();
+        }
+
+        members[inserted.first->second].push_back(i);
+    }
+
+    std::vector<basic_registered_metric*> registered;
+    repo_.get_or_add_all(names, [tn = mtype]() { return std::make_unique<registered_metric<TMetricType>>(tn); }, registered);
+    for (auto r : registered)
+    {
+        if (r->type() != mtype)
+            throw metric_type_mismatch(r->type(), mtype);
+    }
+
+    std::vector<std::shared_ptr<TMetricType>> result(entries.size());
+    for (std::size_t i = 0; i < registered.size(); i++)
+        static_cast<registered_metric<TMetricType>*>(registered[i])->add_all(entries, members[i], result);
+
+    return result;
+}
+
+template<typename TRepository>
+template<typename TMetricType, typename... TConstructorArgs>
+bound_metric_ref<TMetricType> metrics_registry<TRepository>::bind(const metric_path& name, const tag_collection& tags, TConstructorArgs&&... args)
+{
+    auto& r = get<TMetricType>(name);
+    typename registered_metric<TMetricType>::metric_builder builder = [args...]() {
+        return std::make_shared<TMetricType>(args...);
+    };
+
+    auto key = r.bind(repo_.tags(tags), builder);
+    return bound_metric_ref<TMetricType>(key, std::move(builder));
+}
+
 template<typename TRepository>
 template<typename TCount>
 std::shared_ptr<cxxmetrics::counter<TCount>> metrics_registry<TRepository>::counter(const metric_path& name,
@@ -730,6 +1716,15 @@ std::shared_ptr<cxxmetrics::counter<TCount>> metrics_registry<TRepository>::coun
     return get<cxxmetrics::counter<TCount>>(name, tags, std::forward<TCount>(initialValue));
 }
 
+template<typename TRepository>
+template<typename TCount, std::size_t TStripes>
+std::shared_ptr<cxxmetrics::striped_counter<TCount, TStripes>> metrics_registry<TRepository>::striped_counter(const metric_path& name,
+        TCount&& initialValue,
+        const tag_collection& tags)
+{
+    return get<cxxmetrics::striped_counter<TCount, TStripes>>(name, tags, std::forward<TCount>(initialValue));
+}
+
 template<typename TRepository>
 template<period::value Window, period::value Interval, typename TValue>
 std::shared_ptr<cxxmetrics::ewma<Window, Interval, TValue>> metrics_registry<TRepository>::ewma(const metric_path& name,
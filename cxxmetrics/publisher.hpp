@@ -160,6 +160,10 @@ public:
      */
     void visit(const histogram_snapshot &snapshot, const quantile_visitor &visitor) const override
     {
+        // only partition the snapshot around the quantiles we're going to publish rather than sorting it
+        static constexpr long double selected[] = { (((long double)quantile(TQuantiles))/100.0)... };
+        snapshot.select(selected, sizeof...(TQuantiles));
+
         visit_one<TQuantiles...> fn;
         fn(snapshot, visitor);
     }
@@ -528,9 +532,29 @@ protected:
 
     /**
      * \brief a convenience wrapper around \refitem metrics_registry::visit_registered_metrics
+     *
+     * The registry is swept of permutations past their retention first, so they aren't published.
      */
     template<typename THandler>
     void visit_all(THandler&& handler) const;
+
+    /**
+     * \brief Visit the metrics for a publish of only what changed since the last one
+     *
+     * The handler is called the same way as with visit_all, but only for metrics with a series that changed, and
+     * should visit the series with basic_registered_metric::visit_changed and the same generation. Pass the
+     * returned generation the next time.
+     *
+     * \note an update racing the start of the visit can be stamped with the generation that's ending after the
+     * visit has passed it, so the returned generation is the one that was ending and the next visit includes the
+     * series changed during this one again. Series can be published twice that way, but they're never missed.
+     *
+     * \param since the generation returned by the previous call, or 0 to publish everything
+     *
+     * \return the generation to pass the next time
+     */
+    template<typename THandler>
+    std::uint64_t visit_changed(std::uint64_t since, THandler&& handler) const;
 public:
     /**
      * \brief Construct a publisher that will publish from the specified registry
@@ -152,9 +152,27 @@ template<typename TMetricRepo>
 template<typename THandler>
 void metrics_publisher<TMetricRepo>::visit_all(THandler&& handler) const
 {
+    registry_.sweep();
     registry_.visit_registered_metrics(std::forward<THandler>(handler));
 }
 
+template<typename TMetricRepo>
+template<typename THandler>
+std::uint64_t metrics_publisher<TMetricRepo>::visit_changed(std::uint64_t since, THandler&& handler) const
+{
+    registry_.sweep();
+
+    // an update racing this can still be stamped with the generation that's ending after the visit has passed it,
+    // so the next visit starts from that generation rather than the new one
+    auto next = registry_.next_generation();
+    registry_.visit_registered_metrics([since, &handler](const metric_path& path, basic_registered_metric& metric) {
+        if (since == 0 || metric.changed_since(since))
+            handler(path, metric);
+    });
+
+    return next - 1;
+}
+
 }
 
 #endif //CXXMETRICS_PUBLISHER_IMPL_HPP
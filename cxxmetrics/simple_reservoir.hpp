@@ -39,9 +39,9 @@ public:
      *
      * \return a reservoir
      */
-    reservoir_snapshot snapshot() const noexcept
+    basic_reservoir_snapshot<TElem> snapshot() const noexcept
     {
-        return reservoir_snapshot(data_.begin(), data_.end(), TSize);
+        return basic_reservoir_snapshot<TElem>(data_.begin(), data_.end(), TSize);
     }
 
 };
@@ -134,7 +134,7 @@ bool timed_data<T, TClockGet>::operator!=(const timed_data &other) const noexcep
  * \tparam TMaxSize the maximum size of the data in the reservoir
  * \tparam TClockGet the 'functor' (the C++ kind, not an actual functor) that gets the current time
  */
-template<typename TElem, size_t TMaxSize, typename TClockGet = steady_clock_point>
+template<typename TElem, size_t TMaxSize, typename TClockGet = default_clock_point>
 class sliding_window_reservoir
 {
 public:
@@ -205,7 +205,7 @@ public:
      *
      * \return a reservoir snapshot
      */
-    reservoir_snapshot snapshot() const noexcept;
+    basic_reservoir_snapshot<TElem> snapshot() const noexcept;
 };
 
 template<typename TElem, size_t TMaxSize, typename TClockGet>
@@ -254,7 +254,7 @@ void sliding_window_reservoir<TElem, TMaxSize, TClockGet>::update(const TElem &v
 }
 
 template<typename TElem, size_t TMaxSize, typename TClockGet>
-reservoir_snapshot sliding_window_reservoir<TElem, TMaxSize, TClockGet>::snapshot() const noexcept
+basic_reservoir_snapshot<TElem> sliding_window_reservoir<TElem, TMaxSize, TClockGet>::snapshot() const noexcept
 {
     auto now = clock_();
     auto min = now - window_;
@@ -266,7 +266,7 @@ reservoir_snapshot sliding_window_reservoir<TElem, TMaxSize, TClockGet>::snapsho
             break;
     }
 
-    return reservoir_snapshot(transform_iterator(begin), transform_iterator(data_.end()), TMaxSize);
+    return basic_reservoir_snapshot<TElem>(transform_iterator(begin), transform_iterator(data_.end()), TMaxSize);
 }
 
 }
@@ -0,0 +1,324 @@
+#ifndef CXXMETRICS_SNAPSHOT_SCHEDULER_HPP
+#define CXXMETRICS_SNAPSHOT_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "metrics_registry.hpp"
+#include "worker_pool.hpp"
+
+namespace cxxmetrics
+{
+
+/**
+ * \brief Snapshots of every metric in a registry, all taken at one time and never changed afterwards
+ *
+ * A set can be shared by any number of threads reading it at once. It refers back to the registered metrics so
+ * publishers can find their publish options and data, so it mustn't outlive the registry it was taken from.
+ */
+class snapshot_set
+{
+public:
+    /**
+     * \brief The snapshots of each of the tagged permutations of one registered metric
+     */
+    class metric_snapshots
+    {
+        metric_path path_;
+        basic_registered_metric* metric_;
+        std::vector<std::pair<tag_collection, std::unique_ptr<internal::stored_snapshot>>> series_;
+
+        friend class snapshot_set;
+    public:
+        metric_snapshots(const metric_path& path, basic_registered_metric& metric) :
+                path_(path),
+                metric_(&metric)
+        { }
+
+        /**
+         * \brief Get the path the metric is registered at
+         */
+        const metric_path& path() const noexcept
+        {
+            return path_;
+        }
+
+        /**
+         * \brief Get the registered metric the snapshots were taken from
+         */
+        basic_registered_metric& registered() const noexcept
+        {
+            return *metric_;
+        }
+
+        /**
+         * \brief Get the number of tagged permutations in the snapshots
+         */
+        std::size_t size() const noexcept
+        {
+            return series_.size();
+        }
+
+        /**
+         * \brief Visits the snapshots with their tags, like basic_registered_metric::visit
+         *
+         * \param handler the handler to call with the tags and the snapshot of each permutation
+         */
+        template<typename THandler>
+        void visit(THandler&& handler) const;
+    };
+
+private:
+    std::vector<metric_snapshots> metrics_;
+    std::chrono::steady_clock::time_point taken_at_;
+
+public:
+    using const_iterator = std::vector<metric_snapshots>::const_iterator;
+
+    /**
+     * \brief Snapshot every metric in a registry
+     *
+     * \param registry the registry to snapshot
+     */
+    template<typename TRepository>
+    explicit snapshot_set(metrics_registry<TRepository>& registry);
+
+    /**
+     * \brief Snapshot every metric in a registry, splitting the metrics up across a pool of threads
+     *
+     * The metrics are in the same order as they would be if they were snapshotted on one thread.
+     *
+     * \param registry the registry to snapshot
+     * \param workers the threads to snapshot the metrics on
+     */
+    template<typename TRepository>
+    snapshot_set(metrics_registry<TRepository>& registry, worker_pool& workers);
+
+    snapshot_set(const snapshot_set&) = delete;
+    snapshot_set& operator=(const snapshot_set&) = delete;
+
+    const_iterator begin() const noexcept
+    {
+        return metrics_.begin();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return metrics_.end();
+    }
+
+    /**
+     * \brief Get the snapshots of the metric at a position in the set
+     */
+    const metric_snapshots& operator[](std::size_t index) const noexcept
+    {
+        return metrics_[index];
+    }
+
+    /**
+     * \brief Get the number of registered metrics in the set
+     */
+    std::size_t size() const noexcept
+    {
+        return metrics_.size();
+    }
+
+    /**
+     * \brief Get when the snapshots were taken
+     */
+    std::chrono::steady_clock::time_point taken_at() const noexcept
+    {
+        return taken_at_;
+    }
+};
+
+template<typename THandler>
+void snapshot_set::metric_snapshots::visit(THandler&& handler) const
+{
+    for (const auto& series : series_)
+    {
+        const auto& tags = series.first;
+        auto bound = [&handler, &tags](const auto& snapshot) -> decltype(handler(tags, snapshot)) {
+            return handler(tags, snapshot);
+        };
+
+        invokable_snapshot_visitor<decltype(bound)> visitor(std::move(bound));
+        series.second->accept(visitor);
+    }
+}
+
+template<typename TRepository>
+snapshot_set::snapshot_set(metrics_registry<TRepository>& registry) :
+        taken_at_(std::chrono::steady_clock::now())
+{
+    registry.visit_registered_metrics([this](const metric_path& path, basic_registered_metric& metric) {
+        metrics_.emplace_back(path, metric);
+        metric.capture(metrics_.back().series_);
+    });
+}
+
+template<typename TRepository>
+snapshot_set::snapshot_set(metrics_registry<TRepository>& registry, worker_pool& workers) :
+        taken_at_(std::chrono::steady_clock::now())
+{
+    registry.visit_registered_metrics([this](const metric_path& path, basic_registered_metric& metric) {
+        metrics_.emplace_back(path, metric);
+    });
+
+    workers.partition(metrics_.size(), [this](std::size_t, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+            metrics_[i].metric_->capture(metrics_[i].series_);
+    });
+}
+
+/**
+ * \brief Snapshots a registry on a thread of its own so publishers only have to write out the latest snapshots
+ *
+ * Snapshotting can be expensive: reservoirs get copied and sorted and meters get ticked. The scheduler does it once
+ * an interval no matter how many publishers there are, and publishers pick up the latest snapshot_set instead of
+ * doing it on whatever thread asked them to publish. The registry is swept of expired permutations before each
+ * snapshot, the same as publishers sweep it when they visit it. Registries too big to snapshot on one thread within
+ * the interval can be split up across more threads with a concurrency above 1.
+ *
+ * \tparam TRepository the repository type of the registry
+ */
+template<typename TRepository>
+class snapshot_scheduler
+{
+    metrics_registry<TRepository>& registry_;
+    std::chrono::steady_clock::duration interval_;
+    worker_pool workers_;
+    std::shared_ptr<const snapshot_set> latest_;
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    bool running_;
+    std::thread thread_;
+
+    void run();
+
+public:
+    /**
+     * \brief Create a scheduler for a registry, which doesn't snapshot anything until it's started
+     *
+     * \param registry the registry to snapshot
+     * \param interval how often to snapshot the registry
+     * \param concurrency the number of threads to snapshot the registry on, including the scheduler's thread
+     */
+    snapshot_scheduler(metrics_registry<TRepository>& registry, std::chrono::steady_clock::duration interval, std::size_t concurrency = 1) :
+            registry_(registry),
+            interval_(interval),
+            workers_(concurrency),
+            running_(false)
+    { }
+
+    snapshot_scheduler(const snapshot_scheduler&) = delete;
+    snapshot_scheduler& operator=(const snapshot_scheduler&) = delete;
+
+    ~snapshot_scheduler()
+    {
+        stop();
+    }
+
+    /**
+     * \brief Take the first snapshot and start taking the rest on the scheduler's thread
+     *
+     * \throws whatever taking the first snapshot threw, in which case the scheduler isn't started
+     */
+    void start();
+
+    /**
+     * \brief Stop taking snapshots, keeping the latest one
+     */
+    void stop();
+
+    /**
+     * \brief Snapshot the registry now on the calling thread and make it the latest
+     *
+     * \return the snapshots that were taken
+     */
+    std::shared_ptr<const snapshot_set> snapshot_now();
+
+    /**
+     * \brief Get the latest snapshots, or nullptr if none have been taken
+     */
+    std::shared_ptr<const snapshot_set> latest() const
+    {
+        return std::atomic_load(&latest_);
+    }
+};
+
+template<typename TRepository>
+void snapshot_scheduler<TRepository>::start()
+{
+    // the lock is held until the thread is running so a stop can't get in before there's a thread to join, and the
+    // scheduler is only marked running once the first snapshot and the thread have both succeeded
+    std::lock_guard<std::mutex> lock(lock_);
+    if (running_)
+        return;
+
+    snapshot_now();
+    thread_ = std::thread([this]() { run(); });
+    running_ = true;
+}
+
+template<typename TRepository>
+void snapshot_scheduler<TRepository>::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!running_)
+            return;
+        running_ = false;
+    }
+
+    wake_.notify_all();
+    thread_.join();
+}
+
+template<typename TRepository>
+std::shared_ptr<const snapshot_set> snapshot_scheduler<TRepository>::snapshot_now()
+{
+    registry_.sweep();
+    std::shared_ptr<const snapshot_set> snapshots = std::make_shared<snapshot_set>(registry_, workers_);
+    std::atomic_store(&latest_, snapshots);
+
+    return snapshots;
+}
+
+template<typename TRepository>
+void snapshot_scheduler<TRepository>::run()
+{
+    auto next = std::chrono::steady_clock::now() + interval_;
+    std::unique_lock<std::mutex> lock(lock_);
+    while (running_)
+    {
+        if (wake_.wait_until(lock, next, [this]() { return !running_; }))
+            break;
+
+        lock.unlock();
+        try
+        {
+            snapshot_now();
+        }
+        catch (...)
+        {
+            // keep the last snapshots and try again next interval
+        }
+
+        // skip intervals that were missed rather than snapshotting back to back to catch up
+        next += interval_;
+        auto now = std::chrono::steady_clock::now();
+        if (next <= now)
+            next = now + interval_;
+        lock.lock();
+    }
+}
+
+}
+
+#endif //CXXMETRICS_SNAPSHOT_SCHEDULER_HPP
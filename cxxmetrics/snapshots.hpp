@@ -4,6 +4,8 @@
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <iterator>
+#include <memory>
 #include "meta.hpp"
 #include "metric_value.hpp"
 
@@ -222,14 +224,68 @@ public:
     }
 };
 
+namespace internal
+{
+
+template<typename TElem>
+inline long double snapshot_float(const TElem& value, std::true_type) noexcept
+{
+    return static_cast<long double>(value);
+}
+
+template<typename TElem>
+inline long double snapshot_float(const TElem& value, std::false_type) noexcept
+{
+    return static_cast<long double>(metric_value(value));
+}
+
+template<typename TRep, typename TPeriod>
+inline long double snapshot_float(const std::chrono::duration<TRep, TPeriod>& value, std::false_type) noexcept
+{
+    return static_cast<long double>(value.count());
+}
+
 /**
- * A reservoir snapshot from which quantiles, mins, and maxes can be grabbed
+ * \brief Get a value from a snapshot as a long double for computing means
  */
-class reservoir_snapshot
+template<typename TElem>
+inline long double snapshot_float(const TElem& value) noexcept
+{
+    return snapshot_float(value, std::is_arithmetic<TElem>());
+}
+
+}
+
+/**
+ * \brief A reservoir snapshot that holds the reservoir's elements in their native type
+ *
+ * The values are only converted to metric_value when a quantile, min, max or mean is requested.
+ *
+ * The values aren't sorted up front. When the quantiles that will be read are known ahead of time they
+ * can be passed to select(), which only partitions the values around the ranks those quantiles need.
+ * Reading a quantile whose ranks weren't selected sorts the whole snapshot. Because of this, a snapshot
+ * shouldn't be read from multiple threads at once unless it's been sorted first.
+ *
+ * \tparam TElem the type of elements in the snapshot
+ */
+template<typename TElem>
+class basic_reservoir_snapshot
 {
 protected:
-    std::vector<metric_value> values_;
+    mutable std::vector<TElem> values_;
+    // the ranks whose values are known to be in their sorted position
+    mutable std::vector<std::size_t> pinned_;
+    mutable bool sorted_;
+
+    bool is_pinned(std::size_t rank) const noexcept
+    {
+        return sorted_ || std::binary_search(pinned_.begin(), pinned_.end(), rank);
+    }
+
+    void pin(std::size_t rank) const noexcept;
 public:
+    using value_type = TElem;
+
     /**
      * \brief Construct a snapshot using the specified iterators
      *
@@ -238,7 +294,7 @@ public:
      * \param size the expected size for the snapshot
      */
     template <class TInputIterator>
-    reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept;
+    basic_reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept;
 
     /**
      * \brief Construct a snapshot with the c style array
@@ -246,21 +302,13 @@ public:
      * \param a The array from which to construct the snapshot
      * \param count the number of items in the array
      */
-    template<typename TElem>
-    reservoir_snapshot(const TElem *a, std::size_t count) noexcept;
+    basic_reservoir_snapshot(const TElem *a, std::size_t count) noexcept;
 
-    /**
-     * \brief Move constructor
-     */
-    reservoir_snapshot(reservoir_snapshot &&other) noexcept;
-
-    /**
-     * \brief Move assignment constructor
-     */
-    reservoir_snapshot &operator=(reservoir_snapshot &&other) noexcept;
+    basic_reservoir_snapshot(basic_reservoir_snapshot &&other) noexcept = default;
+    basic_reservoir_snapshot &operator=(basic_reservoir_snapshot &&other) noexcept = default;
 
-    reservoir_snapshot(const reservoir_snapshot &c) = delete;
-    reservoir_snapshot &operator=(const reservoir_snapshot &c) = delete;
+    basic_reservoir_snapshot(const basic_reservoir_snapshot &c) = delete;
+    basic_reservoir_snapshot &operator=(const basic_reservoir_snapshot &c) = delete;
 
     /**
      * \brief Get the value at a specified quantile
@@ -275,43 +323,37 @@ public:
         constexpr auto q = ((long double)quantile(TQuantile))/100.0;
         static_assert(q >= 0 && q <= 1, "The provided quantile value is invalid. Must be between 0 and 1");
 
-        if (values_.size() < 1)
-            return metric_value(0);
+        return value(q);
+    }
 
-        auto pos = q * (values_.size() + 1);
-        auto index = static_cast<int64_t>(pos);
+    /**
+     * \brief Prepare the snapshot for reading a known set of quantiles without sorting all of the values
+     *
+     * \param quantiles the quantiles that will be read, each between 0 and 1
+     * \param count the number of quantiles
+     */
+    void select(const long double* quantiles, std::size_t count) const noexcept;
 
-        if (index < 1)
-            return min();
-        if (static_cast<std::size_t>(index) >= values_.size())
-            return max();
+    /**
+     * \brief Sort all of the values, after which reading the snapshot never modifies it
+     */
+    void sort() const noexcept;
 
-        return values_[index - 1] + metric_value((pos - index) * static_cast<long double>(values_[index] - values_[index - 1]));
-    }
+    /**
+     * \brief Get the value at a quantile that's only known at runtime
+     *
+     * \param q the quantile between 0 and 1
+     *
+     * \return the value at the specified quantile
+     */
+    metric_value value(long double q) const noexcept;
 
     /**
      * \brief Get the mean value in the snapshot
      *
      * \return the snapshot mean
      */
-    metric_value mean() const noexcept
-    {
-        if (values_.empty())
-            return metric_value(0);
-
-        metric_value total = values_[0];
-
-        // should we worry about overflow here?
-        for (std::size_t i = 1; i < values_.size(); i++)
-        {
-            auto vs = i + 1.0l;
-            long double eratio = i / vs;
-            long double nratio = 1.0l / vs;
-            total = (total * metric_value(eratio)) + (values_[i] * metric_value(nratio));
-        }
-
-        return total;
-    }
+    metric_value mean() const noexcept;
 
     /**
      * \brief Get the minimum value in the snapshot
@@ -320,7 +362,11 @@ public:
      */
     metric_value min() const noexcept
     {
-        return values_.empty() ? metric_value(std::numeric_limits<int64_t>::min()) : values_[0];
+        if (values_.empty())
+            return metric_value(std::numeric_limits<int64_t>::min());
+
+        pin(0);
+        return metric_value(values_.front());
     }
 
     /**
@@ -330,170 +376,436 @@ public:
      */
     metric_value max() const noexcept
     {
-        return values_.empty() ? metric_value(std::numeric_limits<int64_t>::max()) : values_[values_.size()-1];
+        if (values_.empty())
+            return metric_value(std::numeric_limits<int64_t>::max());
+
+        pin(values_.size() - 1);
+        return metric_value(values_.back());
     }
 
     /**
      * Get the number of elements in the data inside the snapshot
      *
-     * \return the number of elements in teh snapshot
+     * \return the number of elements in the snapshot
      */
-    std::size_t size() const
+    std::size_t size() const noexcept
     {
         return values_.size();
     }
+
+    /**
+     * \brief Merge the values from another snapshot into this one
+     *
+     * \param other the snapshot to merge in
+     */
+    void merge(const basic_reservoir_snapshot& other);
+
+    /**
+     * \brief Get the sorted values in the snapshot
+     */
+    const std::vector<TElem>& values() const noexcept
+    {
+        sort();
+        return values_;
+    }
 };
 
+template<typename TElem>
 template<typename TInputIterator>
-reservoir_snapshot::reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept
+basic_reservoir_snapshot<TElem>::basic_reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept :
+        sorted_(false)
 {
     values_.reserve(size);
 
     std::size_t at = 0;
     for (; begin != end && at++ < size; ++begin)
         values_.emplace_back(*begin);
+}
+
+template<typename TElem>
+basic_reservoir_snapshot<TElem>::basic_reservoir_snapshot(const TElem *a, std::size_t count) noexcept :
+        values_(a, a + count),
+        sorted_(false)
+{ }
+
+template<typename TElem>
+void basic_reservoir_snapshot<TElem>::pin(std::size_t rank) const noexcept
+{
+    if (sorted_)
+        return;
+
+    auto next = std::lower_bound(pinned_.begin(), pinned_.end(), rank);
+    if (next != pinned_.end() && *next == rank)
+        return;
+
+    // everything between the neighbouring pinned ranks is already in the right partition
+    std::size_t from = (next == pinned_.begin()) ? 0 : *(next - 1) + 1;
+    std::size_t to = (next == pinned_.end()) ? values_.size() : *next;
+
+    std::nth_element(values_.begin() + from, values_.begin() + rank, values_.begin() + to);
+    pinned_.insert(next, rank);
+}
+
+template<typename TElem>
+void basic_reservoir_snapshot<TElem>::sort() const noexcept
+{
+    if (sorted_)
+        return;
 
     std::sort(values_.begin(), values_.end());
+    pinned_.clear();
+    sorted_ = true;
 }
 
 template<typename TElem>
-reservoir_snapshot::reservoir_snapshot(const TElem *a, std::size_t count) noexcept
+void basic_reservoir_snapshot<TElem>::select(const long double* quantiles, std::size_t count) const noexcept
 {
-    values_.reserve(count);
+    if (sorted_ || values_.empty())
+        return;
 
-    std::size_t at = 0;
-    for (; at < count; ++at)
-        values_.emplace_back(a[at]);
+    std::vector<std::size_t> ranks;
+    ranks.reserve(count * 2);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        auto index = static_cast<int64_t>(quantiles[i] * (values_.size() + 1));
+        if (index < 1)
+            ranks.push_back(0);
+        else if (static_cast<std::size_t>(index) >= values_.size())
+            ranks.push_back(values_.size() - 1);
+        else
+        {
+            ranks.push_back(index - 1);
+            ranks.push_back(index);
+        }
+    }
 
-    std::sort(values_.begin(), values_.end());
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+    for (auto rank : ranks)
+        pin(rank);
 }
 
-inline reservoir_snapshot::reservoir_snapshot(reservoir_snapshot&& other) noexcept :
-        values_(std::move(other.values_))
-{ }
+template<typename TElem>
+metric_value basic_reservoir_snapshot<TElem>::value(long double q) const noexcept
+{
+    if (values_.size() < 1)
+        return metric_value(0);
+
+    auto pos = q * (values_.size() + 1);
+    auto index = static_cast<int64_t>(pos);
+
+    if (index < 1)
+        return min();
+    if (static_cast<std::size_t>(index) >= values_.size())
+        return max();
+    if (!is_pinned(index - 1) || !is_pinned(index))
+        sort();
 
-inline reservoir_snapshot& reservoir_snapshot::operator=(reservoir_snapshot&& other) noexcept
+    metric_value lower(values_[index - 1]);
+    return lower + metric_value((pos - index) * static_cast<long double>(metric_value(values_[index]) - lower));
+}
+
+template<typename TElem>
+metric_value basic_reservoir_snapshot<TElem>::mean() const noexcept
 {
-    values_ = std::move(other.values_);
-    return *this;
+    if (values_.empty())
+        return metric_value(0);
+    if (values_.size() == 1)
+        return metric_value(values_[0]);
+
+    long double total = 0;
+    for (const auto& v : values_)
+        total += internal::snapshot_float(v);
+
+    return metric_value(total / values_.size());
 }
 
-class histogram_snapshot : public reservoir_snapshot
+template<typename TElem>
+void basic_reservoir_snapshot<TElem>::merge(const basic_reservoir_snapshot& other)
 {
-    uint64_t count_;
+    values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+    pinned_.clear();
+    sorted_ = false;
+}
+
+namespace internal
+{
+
+/**
+ * \brief The type erased data behind a reservoir_snapshot
+ */
+class reservoir_snapshot_data
+{
+public:
+    virtual ~reservoir_snapshot_data() = default;
+
+    virtual metric_value value(long double q) const noexcept = 0;
+    virtual metric_value mean() const noexcept = 0;
+    virtual metric_value min() const noexcept = 0;
+    virtual metric_value max() const noexcept = 0;
+    virtual std::size_t size() const noexcept = 0;
+    virtual void select(const long double* quantiles, std::size_t count) const noexcept = 0;
+
+    /**
+     * \brief Put the data in a state where reading it never modifies it, if reading it ever does
+     */
+    virtual void sort() const noexcept
+    { }
 
-    template<typename TContainer1, typename TContainer2>
-    class alternating_iterator : public std::iterator<std::forward_iterator_tag, metric_value>
+    /**
+     * \brief Append the snapshot values as metric_values for merging with a snapshot of a different type
+     */
+    virtual void append_to(std::vector<metric_value>& values) const = 0;
+
+    /**
+     * \brief Merge another snapshot's data into this one if the data is of the same type
+     *
+     * \return true if the data could be merged without converting the values
+     */
+    virtual bool merge_same(const reservoir_snapshot_data& other) = 0;
+};
+
+template<typename TElem>
+class typed_reservoir_snapshot_data : public reservoir_snapshot_data
+{
+    basic_reservoir_snapshot<TElem> snapshot_;
+public:
+    typed_reservoir_snapshot_data(basic_reservoir_snapshot<TElem>&& snapshot) noexcept :
+            snapshot_(std::move(snapshot))
+    { }
+
+    metric_value value(long double q) const noexcept override
     {
-        using iterator1 = typename TContainer1::const_iterator;
-        using iterator2 = typename TContainer2::const_iterator;
+        return snapshot_.value(q);
+    }
 
-        const TContainer1& srca_;
-        const TContainer2& srcb_;
+    metric_value mean() const noexcept override
+    {
+        return snapshot_.mean();
+    }
 
-        iterator1 a_;
-        iterator2 b_;
+    metric_value min() const noexcept override
+    {
+        return snapshot_.min();
+    }
 
-        bool ata_;
+    metric_value max() const noexcept override
+    {
+        return snapshot_.max();
+    }
 
-        metric_value current_;
-        void set_current()
-        {
-            if ((ata_ || b_ == srcb_.end()) && a_ != srca_.end())
-                current_ = metric_value(*a_);
-            else if (b_ != srcb_.end())
-                current_ = metric_value(*b_);
-        }
-    public:
+    std::size_t size() const noexcept override
+    {
+        return snapshot_.size();
+    }
 
-        alternating_iterator(const TContainer1& first, const TContainer2& second, iterator1&& a, iterator2&& b) :
-                srca_(first),
-                srcb_(second),
-                a_(std::forward<iterator1>(a)),
-                b_(std::forward<iterator2>(b)),
-                ata_(false),
-                current_(0)
-        {
-            if (a_ != srca_.end() && b_ != srcb_.end())
-                set_current();
-        }
-        alternating_iterator(const TContainer1& first, const TContainer2& second) :
-                alternating_iterator(first, second, first.begin(), second.begin())
-        { }
+    void select(const long double* quantiles, std::size_t count) const noexcept override
+    {
+        snapshot_.select(quantiles, count);
+    }
 
-        alternating_iterator begin() const
-        {
-            return alternating_iterator(srca_, srcb_);
-        }
+    void sort() const noexcept override
+    {
+        snapshot_.sort();
+    }
 
-        alternating_iterator end()
-        {
-            return alternating_iterator(srca_, srcb_, srca_.end(), srcb_.end());
-        }
+    void append_to(std::vector<metric_value>& values) const override
+    {
+        for (const auto& v : snapshot_.values())
+            values.emplace_back(v);
+    }
 
-        alternating_iterator& operator++()
-        {
-            if (a_ == srca_.end() && b_ == srcb_.end())
-                return *this;
-
-            ata_ = !ata_;
-            if (ata_ && a_ != srca_.end())
-            {
-                while (a_ != srca_.end() && *a_ <= current_)
-                    ++a_;
-
-                if (a_ == srca_.end() && b_ != srcb_.end())
-                    ++b_;
-            }
-            else
-            {
-                while (b_ != srcb_.end() && *b_ <= current_)
-                    ++b_;
-
-                if (b_ == srcb_.end() && a_ != srca_.end())
-                    ++a_;
-            }
-
-            if (a_ == srca_.end() && b_ == srcb_.end())
-                return *this;
-
-            set_current();
-            return *this;
-        }
+    bool merge_same(const reservoir_snapshot_data& other) override
+    {
+        auto same = dynamic_cast<const typed_reservoir_snapshot_data*>(&other);
+        if (!same)
+            return false;
 
-        void operator++(int)
-        {
-            this->operator++();
-        }
+        snapshot_.merge(same->snapshot_);
+        return true;
+    }
+};
 
-        const metric_value* operator->() const
-        {
-            return &current_;
-        }
+}
 
-        const metric_value& operator*() const
-        {
-            return current_;
-        }
+/**
+ * A reservoir snapshot from which quantiles, mins, and maxes can be grabbed
+ *
+ * This wraps a basic_reservoir_snapshot of any element type so that histogram and timer snapshots
+ * don't need to know the type of the reservoir they came from.
+ */
+class reservoir_snapshot
+{
+protected:
+    std::unique_ptr<internal::reservoir_snapshot_data> data_;
+public:
+    /**
+     * \brief Construct a snapshot using the specified iterators
+     *
+     * \param begin the beginning of the collection
+     * \param end the end of the collection
+     * \param size the expected size for the snapshot
+     */
+    template <class TInputIterator>
+    reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept;
 
-        bool operator==(const alternating_iterator& other) const
-        {
-            if (a_ == srca_.end() && b_ == srcb_.end())
-                return other.a_ == other.srca_.end() && other.b_ == other.srcb_.end();
-            return a_ == other.a_ && b_ == other.b_;
-        }
+    /**
+     * \brief Construct a snapshot with the c style array
+     *
+     * \param a The array from which to construct the snapshot
+     * \param count the number of items in the array
+     */
+    template<typename TElem>
+    reservoir_snapshot(const TElem *a, std::size_t count) noexcept;
 
-        bool operator!=(const alternating_iterator& other) const
-        {
-            return !operator==(other);
-        }
-    };
+    /**
+     * \brief Construct a snapshot from a typed reservoir snapshot
+     *
+     * \param snapshot the typed snapshot
+     */
+    template<typename TElem>
+    reservoir_snapshot(basic_reservoir_snapshot<TElem>&& snapshot) noexcept;
+
+    /**
+     * \brief Construct a snapshot from already type erased snapshot data
+     *
+     * \param data the snapshot data
+     */
+    explicit reservoir_snapshot(std::unique_ptr<internal::reservoir_snapshot_data>&& data) noexcept :
+            data_(std::move(data))
+    { }
+
+    /**
+     * \brief Move constructor
+     */
+    reservoir_snapshot(reservoir_snapshot &&other) noexcept = default;
+
+    /**
+     * \brief Move assignment constructor
+     */
+    reservoir_snapshot &operator=(reservoir_snapshot &&other) noexcept = default;
+
+    reservoir_snapshot(const reservoir_snapshot &c) = delete;
+    reservoir_snapshot &operator=(const reservoir_snapshot &c) = delete;
+
+    /**
+     * \brief Get the value at a specified quantile
+     *
+     * \tparam TQuantile the quantile for which to get the value. Must be between 0 and 100. For example 99.999_p
+     *
+     * \return the value at the specified quantile
+     */
+    template<quantile::value TQuantile>
+    metric_value value() const noexcept
+    {
+        constexpr auto q = ((long double)quantile(TQuantile))/100.0;
+        static_assert(q >= 0 && q <= 1, "The provided quantile value is invalid. Must be between 0 and 1");
+
+        return data_->value(q);
+    }
+
+    /**
+     * \brief Get the mean value in the snapshot
+     *
+     * \return the snapshot mean
+     */
+    metric_value mean() const noexcept
+    {
+        return data_->mean();
+    }
+
+    /**
+     * \brief Get the minimum value in the snapshot
+     *
+     * \return The minimum value in the snapshot
+     */
+    metric_value min() const noexcept
+    {
+        return data_->min();
+    }
+
+    /**
+     * \brief Get the maximum value in the snapshot
+     *
+     * \return The maximum value in the snapshot
+     */
+    metric_value max() const noexcept
+    {
+        return data_->max();
+    }
+
+    /**
+     * Get the number of elements in the data inside the snapshot
+     *
+     * \return the number of elements in teh snapshot
+     */
+    std::size_t size() const
+    {
+        return data_->size();
+    }
 
-    template<typename TContainer1, typename TContainer2>
-    static constexpr alternating_iterator<TContainer1, TContainer2> make_alternating_iterator(const TContainer1& a, const TContainer2& b)
+    /**
+     * \brief Prepare the snapshot for reading a known set of quantiles without sorting all of the values
+     *
+     * \param quantiles the quantiles that will be read, each between 0 and 1
+     * \param count the number of quantiles
+     */
+    void select(const long double* quantiles, std::size_t count) const noexcept
+    {
+        data_->select(quantiles, count);
+    }
+
+    /**
+     * \brief Sort the snapshot so it can be read from multiple threads at once
+     */
+    void sort() const noexcept
     {
-        return alternating_iterator<TContainer1, TContainer2>(a, b);
+        data_->sort();
     }
+
+    /**
+     * \brief Merge the values from another snapshot into this one
+     *
+     * Snapshots of the same element type are merged natively, otherwise both are converted to metric_values
+     *
+     * \param other the snapshot to merge in
+     */
+    void merge(const reservoir_snapshot& other);
+};
+
+template<typename TInputIterator>
+reservoir_snapshot::reservoir_snapshot(TInputIterator begin, const TInputIterator &end, std::size_t size) noexcept :
+        reservoir_snapshot(basic_reservoir_snapshot<metric_value>(begin, end, size))
+{ }
+
+template<typename TElem>
+reservoir_snapshot::reservoir_snapshot(const TElem *a, std::size_t count) noexcept :
+        reservoir_snapshot(basic_reservoir_snapshot<TElem>(a, count))
+{ }
+
+template<typename TElem>
+reservoir_snapshot::reservoir_snapshot(basic_reservoir_snapshot<TElem>&& snapshot) noexcept :
+        data_(new internal::typed_reservoir_snapshot_data<TElem>(std::move(snapshot)))
+{ }
+
+inline void reservoir_snapshot::merge(const reservoir_snapshot& other)
+{
+    if (data_->merge_same(*other.data_))
+        return;
+
+    std::vector<metric_value> values;
+    values.reserve(size() + other.size());
+    data_->append_to(values);
+    other.data_->append_to(values);
+
+    data_.reset(new internal::typed_reservoir_snapshot_data<metric_value>(basic_reservoir_snapshot<metric_value>(values.begin(), values.end(), values.size())));
+}
+
+class histogram_snapshot : public reservoir_snapshot
+{
+    uint64_t count_;
+
 public:
     histogram_snapshot(reservoir_snapshot&& q, uint64_t count) :
             reservoir_snapshot(std::move(q)),
@@ -514,8 +826,7 @@ public:
 
     void merge(const histogram_snapshot& other)
     {
-        auto b = make_alternating_iterator(values_, other.values_);
-        reservoir_snapshot::operator=(reservoir_snapshot(b, b.end(), std::max(count_, other.count_)));
+        reservoir_snapshot::merge(other);
         count_ += other.count_;
     }
 
@@ -638,6 +949,52 @@ public:
     void visit(const timer_snapshot& timer) override { visit_hnd(timer); }
 };
 
+namespace internal
+{
+
+/**
+ * \brief A snapshot of any type, kept to be visited later
+ */
+class stored_snapshot
+{
+public:
+    virtual ~stored_snapshot() = default;
+    virtual void accept(snapshot_visitor& visitor) const = 0;
+};
+
+/**
+ * \brief A kept snapshot of a specific type
+ *
+ * Reservoir snapshots are sorted up front so the kept snapshot can be read from several threads at once.
+ */
+template<typename TSnapshot>
+class typed_stored_snapshot : public stored_snapshot
+{
+    TSnapshot snapshot_;
+
+    static void prepare(const reservoir_snapshot& snapshot, std::true_type) noexcept
+    {
+        snapshot.sort();
+    }
+
+    static void prepare(const TSnapshot&, std::false_type) noexcept
+    { }
+
+public:
+    explicit typed_stored_snapshot(TSnapshot&& snapshot) :
+            snapshot_(std::move(snapshot))
+    {
+        prepare(snapshot_, std::is_base_of<reservoir_snapshot, TSnapshot>());
+    }
+
+    void accept(snapshot_visitor& visitor) const override
+    {
+        visitor.visit(snapshot_);
+    }
+};
+
+}
+
 }
 
 
@@ -0,0 +1,237 @@
+#ifndef CXXMETRICS_STRIPED_COUNTER_HPP
+#define CXXMETRICS_STRIPED_COUNTER_HPP
+
+#include "metric.hpp"
+#include "internal/thread_stripe.hpp"
+#include <atomic>
+#include <type_traits>
+
+namespace cxxmetrics
+{
+
+/**
+ * \brief A counter that spreads its increments over cache line padded cells
+ *
+ * Every thread increments the cell for its stripe so that a hot counter doesn't turn into a single
+ * contended cache line. The cells are only summed when the value is read, which makes reads more
+ * expensive than on a plain counter and means a read isn't an atomic view of concurrent increments.
+ *
+ * \tparam TCount the type of counter, this needs to be an integral type
+ * \tparam TStripes the number of cells to spread increments across
+ */
+template<typename TCount = int64_t, std::size_t TStripes = 16>
+class striped_counter : public metric<striped_counter<TCount, TStripes>>
+{
+    static_assert(std::is_integral<TCount>::value, "striped_counter can only count integral values");
+    static_assert(TStripes > 0, "striped_counter needs at least one stripe");
+
+    struct cell
+    {
+        std::atomic<TCount> value;
+
+        cell() noexcept :
+                value(0)
+        { }
+    };
+
+    internal::padded_stripe<cell> cells_[TStripes];
+
+    void reset(TCount value) noexcept;
+
+    cell& local() noexcept
+    {
+        return cells_[internal::thread_stripe() % TStripes];
+    }
+
+public:
+    /**
+     * \brief Construct a striped counter
+     *
+     * \param initial_value the initial value of the counter
+     */
+    explicit striped_counter(TCount initial_value = 0) noexcept;
+
+    /**
+     * \brief Copy constructor
+     *
+     * \param c the counter to copy
+     */
+    striped_counter(const striped_counter &c) noexcept;
+
+    /**
+     * \brief Move constructor
+     *
+     * \param c the counter to move from
+     */
+    striped_counter(striped_counter &&c) noexcept;
+
+    ~striped_counter() = default;
+
+    striped_counter &operator=(const striped_counter &c) noexcept;
+    striped_counter &operator=(striped_counter &&c) noexcept;
+
+    /**
+     * \brief explicitly set the counter to a value
+     *
+     * \note this isn't atomic with respect to increments that are happening concurrently
+     *
+     * \param value the value to set the counter to
+     * \return a reference to the counter
+     */
+    striped_counter &operator=(TCount value) noexcept;
+
+    /**
+     * \brief increment the counter by the specified value
+     *
+     * Unlike counter::incr, this doesn't return the new value since getting it would mean reading every cell
+     *
+     * \param by the amount by which to increment the counter
+     */
+    void incr(TCount by) noexcept;
+
+    /**
+     * \brief Get the current value of the counter by summing all of the cells
+     *
+     * \return the current value of the counter
+     */
+    TCount value() const noexcept;
+
+    /**
+     * \brief Convenience cast operator
+     */
+    operator TCount() const
+    {
+        return value();
+    }
+
+    /**
+     * \brief Convenience operator to increment the counter by 1
+     *
+     * \return a reference to the counter
+     */
+    striped_counter &operator++()
+    {
+        incr(1);
+        return *this;
+    }
+
+    /**
+     * \brief Convenience operator to increment the counter by a value
+     *
+     * \param by the amount by which to increment the counter
+     *
+     * \return a reference to the counter
+     */
+    striped_counter &operator+=(TCount by)
+    {
+        incr(by);
+        return *this;
+    }
+
+    /**
+     * \brief Convenience operator to decrement the counter by 1
+     *
+     * \return a reference to the counter
+     */
+    striped_counter &operator--()
+    {
+        incr(-1);
+        return *this;
+    }
+
+    /**
+     * \brief Convenience operator to decrement the counter by a value
+     *
+     * \param by the amount by which to decrement the counter
+     *
+     * \return a reference to the counter
+     */
+    striped_counter &operator-=(TCount by)
+    {
+        incr(-by);
+        return *this;
+    }
+
+    /**
+     * \brief Get a snapshot of the value as it is
+     */
+    cumulative_value_snapshot snapshot() const {
+        return cumulative_value_snapshot(value());
+    }
+};
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes>::striped_counter(TCount initial_value) noexcept
+{
+    cells_[0].value.store(initial_value, std::memory_order_relaxed);
+}
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes>::striped_counter(const striped_counter &c) noexcept :
+        metric<striped_counter<TCount, TStripes>>(c)
+{
+    reset(c.value());
+}
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes>::striped_counter(striped_counter &&c) noexcept :
+        metric<striped_counter<TCount, TStripes>>(c)
+{
+    reset(c.value());
+    c.reset(0);
+}
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes> &striped_counter<TCount, TStripes>::operator=(const striped_counter &c) noexcept
+{
+    reset(c.value());
+    this->changed();
+    return *this;
+}
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes> &striped_counter<TCount, TStripes>::operator=(striped_counter &&c) noexcept
+{
+    reset(c.value());
+    c.reset(0);
+    this->changed();
+    c.changed();
+    return *this;
+}
+
+template<typename TCount, std::size_t TStripes>
+striped_counter<TCount, TStripes> &striped_counter<TCount, TStripes>::operator=(TCount value) noexcept
+{
+    reset(value);
+    this->changed();
+    return *this;
+}
+
+template<typename TCount, std::size_t TStripes>
+void striped_counter<TCount, TStripes>::reset(TCount value) noexcept
+{
+    for (std::size_t i = 1; i < TStripes; i++)
+        cells_[i].value.store(0, std::memory_order_relaxed);
+    cells_[0].value.store(value, std::memory_order_relaxed);
+}
+
+template<typename TCount, std::size_t TStripes>
+void striped_counter<TCount, TStripes>::incr(TCount by) noexcept
+{
+    local().value.fetch_add(by, std::memory_order_relaxed);
+    this->changed();
+}
+
+template<typename TCount, std::size_t TStripes>
+TCount striped_counter<TCount, TStripes>::value() const noexcept
+{
+    TCount result = 0;
+    for (const auto& c : cells_)
+        result += c.value.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+}
+
+#endif //CXXMETRICS_STRIPED_COUNTER_HPP
@@ -1,50 +1,160 @@
 #ifndef CXXMETRICS_TAG_COLLECTION_HPP
 #define CXXMETRICS_TAG_COLLECTION_HPP
 
-#include <unordered_map>
+#include <algorithm>
+#include <initializer_list>
+#include <string>
 #include "metric_value.hpp"
+#include "internal/read_mostly_map.hpp"
+#include "internal/small_vector.hpp"
 
 namespace cxxmetrics
 {
 
+namespace internal
+{
+
+/**
+ * \brief Get the one shared copy of a tag key
+ *
+ * Every tag collection with the same key points at the same string, so keys can be compared by address.
+ * Interned keys live for the rest of the process.
+ */
+inline const std::string* intern_tag_key(const std::string& key)
+{
+    static read_mostly_map<std::string, bool> keys;
+
+    auto hash = keys.hash(key);
+    auto existing = keys.find_entry(key, hash).first;
+    if (existing != nullptr)
+        return existing;
+
+    return keys.get_or_add_entry(key, hash, []() { return true; }).first;
+}
+
+}
+
+/**
+ * \brief The set of tags that tells different instances of a registered metric apart
+ *
+ * The tags are kept in a flat array sorted by key, with the keys interned and the hash calculated once when the
+ * collection is built. Up to 6 tags are stored without allocating.
+ */
 class tag_collection
 {
-    std::unordered_map<std::string, metric_value> tags_;
 public:
-    tag_collection() = default;
+    /**
+     * \brief A single tag, which looks like the pair in a map from tag names to values
+     */
+    struct value_type
+    {
+        const std::string& first;
+        metric_value second;
+
+        value_type(const std::string* key, const metric_value& value) :
+                first(*key),
+                second(value)
+        { }
+
+        value_type(const value_type& other) = default;
+        value_type(value_type&& other) = default;
+    };
+
+private:
+    static constexpr std::size_t inline_tags = 6;
+
+    internal::small_vector<value_type, inline_tags> tags_;
+    std::size_t hash_;
+
+    template<typename TIterator>
+    void build(TIterator begin, TIterator end, std::size_t size);
+
+public:
+    tag_collection() noexcept :
+            hash_(0)
+    { }
+
     tag_collection(const tag_collection&) = default;
+    tag_collection(tag_collection&&) = default;
+    tag_collection& operator=(const tag_collection&) = default;
+    tag_collection& operator=(tag_collection&&) = default;
 
     template<typename TPairCollection>
-    tag_collection(const TPairCollection& pairs, int size = 0) : tags_(pairs.begin(), pairs.end(), size)
-    { }
+    tag_collection(const TPairCollection& pairs, int size = 0) :
+            hash_(0)
+    {
+        build(pairs.begin(), pairs.end(), size);
+    }
 
-    tag_collection(std::initializer_list<typename std::unordered_map<std::string, metric_value>::value_type> tags) :
-            tags_(tags)
-    { }
+    tag_collection(std::initializer_list<std::pair<const std::string, metric_value>> tags) :
+            hash_(0)
+    {
+        build(tags.begin(), tags.end(), tags.size());
+    }
 
-    auto begin() const
+    const value_type* begin() const noexcept
     {
         return tags_.begin();
     }
 
-    auto end() const
+    const value_type* end() const noexcept
     {
         return tags_.end();
     }
 
+    std::size_t size() const noexcept
+    {
+        return tags_.size();
+    }
+
+    /**
+     * \brief Get the hash of the tags, which is calculated when the collection is built
+     */
+    std::size_t hash() const noexcept
+    {
+        return hash_;
+    }
+
     bool operator==(const tag_collection& other) const;
     bool operator!=(const tag_collection& other) const;
 };
 
+template<typename TIterator>
+void tag_collection::build(TIterator begin, TIterator end, std::size_t size)
+{
+    using input = std::pair<const std::string*, const metric_value*>;
+    internal::small_vector<input, inline_tags> sorted;
+    sorted.reserve(size);
+
+    for (auto itr = begin; itr != end; ++itr)
+        sorted.emplace_back(internal::intern_tag_key(itr->first), &itr->second);
+
+    // like a map, the first value given for a key wins
+    std::stable_sort(sorted.begin(), sorted.end(), [](const input& a, const input& b) {
+        return *a.first < *b.first;
+    });
+
+    tags_.reserve(sorted.size());
+    std::hash<const std::string*> keyhash;
+    std::hash<metric_value> valuehash;
+    for (const auto& tag : sorted)
+    {
+        if (!tags_.empty() && &tags_[tags_.size() - 1].first == tag.first)
+            continue;
+
+        tags_.emplace_back(tag.first, *tag.second);
+        hash_ = (hash_ * 397) ^ (keyhash(tag.first) ^ valuehash(*tag.second));
+    }
+}
+
 inline bool tag_collection::operator==(const cxxmetrics::tag_collection &other) const
 {
-    if (tags_.size() != other.tags_.size())
+    if (hash_ != other.hash_ || tags_.size() != other.tags_.size())
         return false;
 
-    for (const auto& p : tags_)
+    for (std::size_t i = 0; i < tags_.size(); ++i)
     {
-        auto f = other.tags_.find(p.first);
-        if (f == other.tags_.end() || f->second != p.second)
+        if (&tags_[i].first != &other.tags_[i].first || tags_[i].second != other.tags_[i].second)
             return false;
     }
 
@@ -66,13 +176,7 @@ struct hash<cxxmetrics::tag_collection>
 {
     std::size_t operator()(const cxxmetrics::tag_collection& collection) const
     {
-        std::size_t result = 0;
-        std::hash<std::string> h;
-        std::hash<cxxmetrics::metric_value> v;
-        for (const auto& p : collection)
-            result = (result * 397) ^ (h(p.first) ^ v(p.second));
-
-        return result;
+        return collection.hash();
     }
 };
 
@@ -99,6 +99,7 @@ public:
         if (duration.count()) {
             histogram_.update(duration);
             meter_.mark();
+            this->changed();
         }
     }
 
@@ -2,9 +2,8 @@
 #define CXXMETRICS_UNIFORM_RESERVOIR_HPP
 
 #include "snapshots.hpp"
+#include "internal/thread_random.hpp"
 #include <atomic>
-#include <chrono>
-#include <random>
 
 namespace cxxmetrics
 {
@@ -12,31 +11,17 @@ namespace cxxmetrics
 /**
  * \brief a Uniform Reservoir for getting percentile samples
  *
+ * Every update past the size of the reservoir shares the count, so for busy multithreaded paths
+ * concurrent_uniform_reservoir is a better fit.
+ *
  * \tparam TElem the type of elements in the reservoir
  * \tparam TSize the size of the reservoir
  */
 template<typename TElem, std::size_t TSize>
 class uniform_reservoir
 {
-    std::default_random_engine gen_;
     TElem elems_[TSize];
     std::atomic_uint_fast64_t count_;
-
-    static unsigned generate_seed() noexcept
-    {
-        auto full = std::chrono::system_clock::now().time_since_epoch();
-        auto nano = std::chrono::duration_cast<std::chrono::nanoseconds>(full);
-
-        auto seed = nano.count();
-        size_t size = sizeof(seed);
-        while (size > sizeof(unsigned))
-        {
-            seed = (seed & 0xffffffff) ^ (seed >> 32);
-            size -= 4;
-        }
-
-        return seed;
-    }
 public:
     using value_type = TElem;
 
@@ -66,22 +51,20 @@ public:
      *
      * \return a reservoir
      */
-    reservoir_snapshot snapshot() const noexcept
+    basic_reservoir_snapshot<TElem> snapshot() const noexcept
     {
-        return reservoir_snapshot(&elems_[0], std::min(count_.load(), static_cast<decltype(count_.load())>(TSize)));
+        return basic_reservoir_snapshot<TElem>(&elems_[0], std::min(count_.load(), static_cast<decltype(count_.load())>(TSize)));
     }
 };
 
 template<typename TElem, std::size_t TSize>
 uniform_reservoir<TElem, TSize>::uniform_reservoir() noexcept :
-        gen_(generate_seed()),
         count_(0)
 {
 }
 
 template<typename TElem, std::size_t TSize>
 uniform_reservoir<TElem, TSize>::uniform_reservoir(const uniform_reservoir &other) noexcept :
-        gen_(generate_seed()),
         count_(other.count_.load())
 {
     for (std::size_t i = 0; i < count_; i++)
@@ -110,8 +93,8 @@ void uniform_reservoir<TElem, TSize>::update(const TElem &value) noexcept
     // so we don't run out of count
     count_.store(TSize);
 
-    std::uniform_int_distribution<> d(0, TSize);
-    elems_[d(gen_)] = value;
+    // each thread has its own generator so they don't race on one
+    elems_[internal::thread_random() % TSize] = value;
 }
 
 }
@@ -0,0 +1,193 @@
+#ifndef CXXMETRICS_WORKER_POOL_HPP
+#define CXXMETRICS_WORKER_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cxxmetrics
+{
+
+/**
+ * \brief A fixed set of threads that split up the work of snapshotting and publishing large registries
+ *
+ * The thread that runs the work takes part in it too, so a pool with a concurrency of 1 has no threads of its own and
+ * runs everything inline. Only one run happens at a time; other threads asking for a run wait for it to finish.
+ */
+class worker_pool
+{
+    std::vector<std::thread> threads_;
+
+    std::mutex run_lock_;
+    std::mutex lock_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    const std::function<void(std::size_t)>* task_;
+    std::size_t count_;
+    std::atomic<std::size_t> next_;
+    std::size_t active_;
+    std::uint64_t round_;
+    bool stopping_;
+    std::exception_ptr error_;
+
+    void work() noexcept
+    {
+        std::size_t index;
+        while ((index = next_.fetch_add(1, std::memory_order_relaxed)) < count_)
+        {
+            try
+            {
+                (*task_)(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(lock_);
+                if (!error_)
+                    error_ = std::current_exception();
+
+                // don't start any more of the work
+                next_.store(count_, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void worker() noexcept
+    {
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(lock_);
+        while (true)
+        {
+            work_ready_.wait(lock, [this, seen]() { return stopping_ || round_ != seen; });
+            if (stopping_)
+                return;
+
+            seen = round_;
+            lock.unlock();
+            work();
+            lock.lock();
+
+            if (--active_ == 0)
+                work_done_.notify_all();
+        }
+    }
+
+public:
+    /**
+     * \brief Create a pool
+     *
+     * \param concurrency the number of threads work is split across, including the thread running it
+     */
+    explicit worker_pool(std::size_t concurrency = std::thread::hardware_concurrency()) :
+            task_(nullptr),
+            count_(0),
+            next_(0),
+            active_(0),
+            round_(0),
+            stopping_(false)
+    {
+        for (std::size_t i = 1; i < concurrency; i++)
+            threads_.emplace_back([this]() { worker(); });
+    }
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    ~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            stopping_ = true;
+        }
+
+        work_ready_.notify_all();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    /**
+     * \brief Get the number of threads work is split across, including the thread running it
+     */
+    std::size_t concurrency() const noexcept
+    {
+        return threads_.size() + 1;
+    }
+
+    /**
+     * \brief Run a task for each index up to a count across the pool, returning once they've all finished
+     *
+     * \throws whatever the first task to fail threw, after the rest of the tasks already started have finished
+     *
+     * \param count the number of tasks
+     * \param task the task to run with each index from 0 to count
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)>& task)
+    {
+        std::lock_guard<std::mutex> run_lock(run_lock_);
+        if (threads_.empty() || count <= 1)
+        {
+            for (std::size_t i = 0; i < count; i++)
+                task(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            task_ = &task;
+            count_ = count;
+            next_.store(0, std::memory_order_relaxed);
+            active_ = threads_.size();
+            error_ = nullptr;
+            ++round_;
+        }
+
+        work_ready_.notify_all();
+        work();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            work_done_.wait(lock, [this]() { return active_ == 0; });
+            task_ = nullptr;
+            std::swap(error, error_);
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /**
+     * \brief Get the number of ranges partition() splits a number of items into
+     */
+    std::size_t partitions(std::size_t items) const noexcept
+    {
+        // a few ranges per thread so one slow range doesn't leave the others idle
+        return std::min(items, concurrency() * 4);
+    }
+
+    /**
+     * \brief Split items into contiguous ranges and run a task for each range across the pool
+     *
+     * The ranges are in order, so results kept by range index can be put back together in the order of the items.
+     *
+     * \param items the number of items
+     * \param task the task to run with the index of each range and the first and one past the last item in it
+     */
+    template<typename TTask>
+    void partition(std::size_t items, TTask&& task)
+    {
+        auto count = partitions(items);
+        run(count, [items, count, &task](std::size_t index) {
+            task(index, items * index / count, items * (index + 1) / count);
+        });
+    }
+};
+
+}
+
+#endif //CXXMETRICS_WORKER_POOL_HPP
@@ -12,16 +12,16 @@ class snapshot_writer<cxxmetrics::cumulative_value_snapshot>
     void write_header() const
     {
         // use untyped instead of counters since counters can be negative per https://prometheus.io/docs/instrumenting/writing_exporters/
-        stream << "# TYPE " << internal::name(path) << " untyped\n";
+        stream << "# TYPE " << name << " untyped\n";
     }
 
     CXXMETRICS_PROMETHEUS_SNAPSHOT_WRITER_INIT
 public:
 
-    void write(const cxxmetrics::tag_collection& tags, const cxxmetrics::cumulative_value_snapshot& snapshot)
+    void write(const std::string& tags, const cxxmetrics::cumulative_value_snapshot& snapshot)
     {
         // metric_name
-        stream << internal::name(path) << '{' << internal::tags(tags) << "} " << internal::scale_value(snapshot.value(), options.value_options()) << "\n";
+        stream << name << '{' << tags << "} " << internal::scale_value(snapshot.value(), options.value_options()) << "\n";
     }
 };
 
@@ -11,16 +11,16 @@ class snapshot_writer<cxxmetrics::average_value_snapshot>
 {
     void write_header() const
     {
-        stream << "# TYPE " << internal::name(path) << " gauge\n";
+        stream << "# TYPE " << name << " gauge\n";
     }
 
     CXXMETRICS_PROMETHEUS_SNAPSHOT_WRITER_INIT
 public:
 
-    void write(const cxxmetrics::tag_collection& tags, const cxxmetrics::average_value_snapshot& snapshot)
+    void write(const std::string& tags, const cxxmetrics::average_value_snapshot& snapshot)
     {
         // metric_name
-        stream << internal::name(path) << '{' << internal::tags(tags) << "} " << internal::scale_value(snapshot.value(), options.value_options()) << "\n";
+        stream << name << '{' << tags << "} " << internal::scale_value(snapshot.value(), options.value_options()) << "\n";
     }
 };
 
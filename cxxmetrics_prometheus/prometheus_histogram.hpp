@@ -11,24 +11,24 @@ class snapshot_writer<cxxmetrics::histogram_snapshot>
 {
     void write_header() const
     {
-        stream << "# TYPE " << internal::name(path) << " summary\n";
+        stream << "# TYPE " << name << " summary\n";
     }
 
     CXXMETRICS_PROMETHEUS_SNAPSHOT_WRITER_INIT
 public:
 
-    void write(const cxxmetrics::tag_collection& tags, const cxxmetrics::histogram_snapshot& snapshot)
+    void write(const std::string& tags, const cxxmetrics::histogram_snapshot& snapshot)
     {
         const char* comma = "";
-        if (tags.begin() != tags.end())
+        if (!tags.empty())
             comma = ",";
 
         if (options.histogram_options().include_count())
-            stream << internal::name(path) << "_count{" << internal::tags(tags) << "} " << internal::scale_value(snapshot.count(), options.histogram_options()) << "\n";
+            stream << name << "_count{" << tags << "} " << internal::scale_value(snapshot.count(), options.histogram_options()) << "\n";
 
-        stream << internal::name(path) << "_mean{" << internal::tags(tags) << "} " << internal::scale_value(snapshot.mean(), options.histogram_options()) << "\n";
+        stream << name << "_mean{" << tags << "} " << internal::scale_value(snapshot.mean(), options.histogram_options()) << "\n";
         options.histogram_options().quantiles().visit(snapshot, [&](cxxmetrics::quantile q, cxxmetrics::metric_value&& value) {
-            stream << internal::name(path) << '{' << "quantile=\"" << (q.percentile() / 100.0) << "\"" << comma << internal::tags(tags) << "} " << internal::scale_value(std::move(value), options.histogram_options()) << "\n";
+            stream << name << '{' << "quantile=\"" << (q.percentile() / 100.0) << "\"" << comma << tags << "} " << internal::scale_value(std::move(value), options.histogram_options()) << "\n";
         });
     }
 };
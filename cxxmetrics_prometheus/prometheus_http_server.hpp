@@ -0,0 +1,776 @@
+#ifndef CXXMETRICS_PROMETHEUS_HTTP_SERVER_HPP
+#define CXXMETRICS_PROMETHEUS_HTTP_SERVER_HPP
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifdef CXXMETRICS_PROMETHEUS_ZLIB
+#include <zlib.h>
+#endif
+#include "prometheus_publisher.hpp"
+
+namespace cxxmetrics_prometheus
+{
+
+/**
+ * \brief The settings for a prometheus http server
+ */
+struct http_server_options
+{
+    /**
+     * \brief The local address to listen on, either IPv4 or IPv6
+     */
+    std::string address = "127.0.0.1";
+
+    /**
+     * \brief The port to listen on, or 0 to listen on any free port
+     *
+     * There's no well known port to default to: 9100 is node_exporter's, and most of the ones near it are taken
+     * by other exporters. So by default the server picks a free port, which prometheus_http_server::port reports,
+     * and anything that's scraped at a fixed address should set its own.
+     */
+    std::uint16_t port = 0;
+
+    /**
+     * \brief The path the metrics are served from
+     */
+    std::string path = "/metrics";
+
+    /**
+     * \brief How long a rendered scrape is served to other scrapers before the registry is published again
+     *
+     * Scrapes that arrive together are always served from the same render, so with the default of 0 only scrapes
+     * that are waiting at the same time share one.
+     */
+    std::chrono::steady_clock::duration coalesce_window = std::chrono::steady_clock::duration::zero();
+
+    /**
+     * \brief How long a connection can sit idle before the server closes it
+     */
+    std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(30);
+
+    /**
+     * \brief Whether responses are gzipped for scrapers that accept it, which needs CXXMETRICS_PROMETHEUS_ZLIB
+     */
+    bool gzip = false;
+
+    /**
+     * \brief The most connections served at once; more wait in the listen backlog
+     */
+    std::size_t max_connections = 64;
+};
+
+namespace internal
+{
+
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+/**
+ * \brief Owns a file descriptor, closing it when it goes away
+ */
+class file_handle
+{
+    int fd_;
+public:
+    explicit file_handle(int fd = -1) noexcept :
+            fd_(fd)
+    { }
+
+    file_handle(const file_handle&) = delete;
+    file_handle(file_handle&& other) noexcept :
+            fd_(other.fd_)
+    {
+        other.fd_ = -1;
+    }
+
+    ~file_handle()
+    {
+        reset();
+    }
+
+    file_handle& operator=(const file_handle&) = delete;
+    file_handle& operator=(file_handle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset(other.fd_);
+            other.fd_ = -1;
+        }
+        return *this;
+    }
+
+    int get() const noexcept { return fd_; }
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+
+    void reset(int fd = -1) noexcept
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = fd;
+    }
+};
+
+inline bool set_nonblocking(int fd) noexcept
+{
+    auto flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+inline bool iequals(const char* a, std::size_t alen, const char* b)
+{
+    auto blen = std::strlen(b);
+    if (alen != blen)
+        return false;
+
+    for (std::size_t i = 0; i < alen; i++)
+    {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Whether a comma separated header value lists a token, ignoring case and any parameters
+ */
+inline bool has_token(const std::string& value, const char* token)
+{
+    std::size_t at = 0;
+    while (at < value.size())
+    {
+        auto end = value.find(',', at);
+        if (end == std::string::npos)
+            end = value.size();
+
+        auto begin = at;
+        while (begin < end && (value[begin] == ' ' || value[begin] == '\t'))
+            ++begin;
+        auto last = begin;
+        while (last < end && value[last] != ';' && value[last] != ' ' && value[last] != '\t')
+            ++last;
+
+        if (iequals(value.data() + begin, last - begin, token))
+            return true;
+        at = end + 1;
+    }
+
+    return false;
+}
+
+/**
+ * \brief The parts of an http request the server cares about
+ */
+struct http_request
+{
+    std::string method;
+    std::string path;
+    bool keep_alive = false;
+    bool accepts_gzip = false;
+    bool has_body = false;
+
+    /**
+     * \brief Parse the request line and headers of a request, without the blank line that ends them
+     *
+     * \return false if the request is malformed
+     */
+    bool parse(const std::string& head)
+    {
+        auto line_end = head.find("\r\n");
+        auto line = head.substr(0, line_end);
+
+        auto method_end = line.find(' ');
+        if (method_end == std::string::npos)
+            return false;
+        auto target_end = line.find(' ', method_end + 1);
+        if (target_end == std::string::npos)
+            return false;
+
+        method = line.substr(0, method_end);
+        path = line.substr(method_end + 1, target_end - method_end - 1);
+        auto query = path.find('?');
+        if (query != std::string::npos)
+            path.resize(query);
+
+        auto version = line.substr(target_end + 1);
+        if (version == "HTTP/1.1")
+            keep_alive = true;
+        else if (version != "HTTP/1.0")
+            return false;
+
+        while (line_end != std::string::npos)
+        {
+            auto begin = line_end + 2;
+            line_end = head.find("\r\n", begin);
+            auto end = line_end == std::string::npos ? head.size() : line_end;
+
+            auto colon = head.find(':', begin);
+            if (colon == std::string::npos || colon > end)
+                return false;
+
+            auto value_begin = colon + 1;
+            while (value_begin < end && (head[value_begin] == ' ' || head[value_begin] == '\t'))
+                ++value_begin;
+            auto value = head.substr(value_begin, end - value_begin);
+            auto name = head.data() + begin;
+            auto namelen = colon - begin;
+
+            if (iequals(name, namelen, "connection"))
+            {
+                if (has_token(value, "close"))
+                    keep_alive = false;
+                else if (has_token(value, "keep-alive"))
+                    keep_alive = true;
+            }
+            else if (iequals(name, namelen, "accept-encoding"))
+                accepts_gzip = has_token(value, "gzip");
+            else if (iequals(name, namelen, "transfer-encoding"))
+                has_body = true;
+            else if (iequals(name, namelen, "content-length"))
+                has_body = has_body || value.find_first_not_of('0') != std::string::npos;
+        }
+
+        return true;
+    }
+};
+
+#ifdef CXXMETRICS_PROMETHEUS_ZLIB
+/**
+ * \brief Compress a response body into the gzip format
+ */
+inline std::shared_ptr<const std::string> gzip(const std::string& body)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 16 added to the window bits asks for a gzip header and trailer rather than a zlib one
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("failed to initialize zlib");
+
+    auto result = std::make_shared<std::string>();
+    result->resize(deflateBound(&stream, static_cast<uLong>(body.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&(*result)[0]);
+    stream.avail_out = static_cast<uInt>(result->size());
+
+    auto status = deflate(&stream, Z_FINISH);
+    result->resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END)
+        throw std::runtime_error("failed to gzip a response");
+
+    return result;
+}
+#endif
+
+/**
+ * \brief A connection to a scraper and the responses still waiting to be sent to it
+ *
+ * Response bodies are shared with every other connection served from the same render, so queueing one doesn't
+ * copy it.
+ */
+struct http_connection
+{
+    file_handle socket;
+    std::string received;
+    std::deque<std::shared_ptr<const std::string>> pending;
+    std::size_t sent = 0;
+    bool close_after_send = false;
+    bool closed = false;
+    std::chrono::steady_clock::time_point active;
+
+    http_connection(file_handle&& fd, std::chrono::steady_clock::time_point now) :
+            socket(std::move(fd)),
+            active(now)
+    { }
+};
+
+}
+
+/**
+ * \brief Serves the prometheus text for a registry over http from a thread of its own
+ *
+ * The server is a single thread polling all of its connections. It speaks just enough HTTP/1.1 for scrapers:
+ * GET and HEAD on the metrics path, keep-alive and pipelined requests, and gzip when it's enabled and the scraper
+ * accepts it. Anything else gets an error response and the connection is closed.
+ *
+ * Every scrape that's waiting when the server goes to render is served from one render, and renders are reused
+ * for the rest of the coalesce window, so several prometheus servers scraping the same process don't multiply
+ * the cost of publishing.
+ *
+ * The server uses POSIX sockets.
+ *
+ * \tparam TMetricRepo the repository type of the registry being served
+ */
+template<typename TMetricRepo>
+class prometheus_http_server
+{
+    using clock = std::chrono::steady_clock;
+
+    prometheus_publisher<TMetricRepo> publisher_;
+    http_server_options options_;
+    internal::file_handle listener_;
+    internal::file_handle wake_reader_;
+    internal::file_handle wake_writer_;
+    std::uint16_t port_;
+    std::atomic<bool> running_;
+    std::atomic<std::uint64_t> renders_;
+    std::thread thread_;
+
+    // only touched by the server thread
+    std::vector<std::unique_ptr<internal::http_connection>> connections_;
+    std::shared_ptr<const std::string> body_;
+    std::shared_ptr<const std::string> gzipped_;
+    clock::time_point rendered_at_;
+    std::uint64_t rendered_pass_;
+    std::uint64_t pass_;
+
+    void listen();
+    void run();
+    void accept_all(clock::time_point now);
+    void receive(internal::http_connection& connection, clock::time_point now);
+    void respond(internal::http_connection& connection, const internal::http_request& request, clock::time_point now);
+    void respond_error(internal::http_connection& connection, const char* status);
+    void send(internal::http_connection& connection, clock::time_point now);
+    const std::shared_ptr<const std::string>& render(bool gzipped, clock::time_point now);
+
+public:
+    /**
+     * \brief Create a server for a registry, which doesn't listen until it's started
+     *
+     * \param registry the registry to serve
+     * \param options the settings for the server
+     */
+    prometheus_http_server(cxxmetrics::metrics_registry<TMetricRepo>& registry, http_server_options options = http_server_options());
+
+    prometheus_http_server(const prometheus_http_server&) = delete;
+    prometheus_http_server& operator=(const prometheus_http_server&) = delete;
+
+    ~prometheus_http_server()
+    {
+        stop();
+    }
+
+    /**
+     * \brief Get the publisher the server renders with, to set the publish options of metrics
+     */
+    prometheus_publisher<TMetricRepo>& publisher() noexcept
+    {
+        return publisher_;
+    }
+
+    /**
+     * \brief Start listening and serving on the server's thread
+     *
+     * \throws std::system_error if the server can't listen on the address and port
+     */
+    void start();
+
+    /**
+     * \brief Stop serving, closing every connection and the listening socket
+     */
+    void stop();
+
+    /**
+     * \brief Get the port the server is listening on, which is the port it picked if it was configured with 0
+     */
+    std::uint16_t port() const noexcept
+    {
+        return port_;
+    }
+
+    /**
+     * \brief Get the number of times the server has published the registry
+     */
+    std::uint64_t renders() const noexcept
+    {
+        return renders_.load(std::memory_order_relaxed);
+    }
+};
+
+template<typename TMetricRepo>
+prometheus_http_server<TMetricRepo>::prometheus_http_server(cxxmetrics::metrics_registry<TMetricRepo>& registry, http_server_options options) :
+        publisher_(registry),
+        options_(std::move(options)),
+        port_(0),
+        running_(false),
+        renders_(0),
+        rendered_pass_(0),
+        pass_(0)
+{
+#ifndef CXXMETRICS_PROMETHEUS_ZLIB
+    if (options_.gzip)
+        throw std::invalid_argument("gzip responses need cxxmetrics_prometheus built with CXXMETRICS_PROMETHEUS_ZLIB");
+#endif
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::listen()
+{
+    sockaddr_storage address;
+    socklen_t address_len;
+    std::memset(&address, 0, sizeof(address));
+
+    auto v4 = reinterpret_cast<sockaddr_in*>(&address);
+    auto v6 = reinterpret_cast<sockaddr_in6*>(&address);
+    if (::inet_pton(AF_INET, options_.address.c_str(), &v4->sin_addr) == 1)
+    {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(options_.port);
+        address_len = sizeof(sockaddr_in);
+    }
+    else if (::inet_pton(AF_INET6, options_.address.c_str(), &v6->sin6_addr) == 1)
+    {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(options_.port);
+        address_len = sizeof(sockaddr_in6);
+    }
+    else
+        throw std::system_error(EINVAL, std::generic_category(), "invalid listen address " + options_.address);
+
+    internal::file_handle listener(::socket(address.ss_family, SOCK_STREAM, 0));
+    if (!listener)
+        throw std::system_error(errno, std::generic_category(), "failed to create the listening socket");
+
+    int on = 1;
+    ::setsockopt(listener.get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::bind(listener.get(), reinterpret_cast<sockaddr*>(&address), address_len) < 0)
+        throw std::system_error(errno, std::generic_category(), "failed to bind " + options_.address + ":" + std::to_string(options_.port));
+    if (::listen(listener.get(), SOMAXCONN) < 0)
+        throw std::system_error(errno, std::generic_category(), "failed to listen");
+
+    address_len = sizeof(address);
+    if (::getsockname(listener.get(), reinterpret_cast<sockaddr*>(&address), &address_len) < 0)
+        throw std::system_error(errno, std::generic_category(), "failed to get the listening port");
+    port_ = ntohs(address.ss_family == AF_INET ? v4->sin_port : v6->sin6_port);
+
+    if (!internal::set_nonblocking(listener.get()))
+        throw std::system_error(errno, std::generic_category(), "failed to make the listening socket non-blocking");
+    listener_ = std::move(listener);
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::start()
+{
+    if (running_)
+        return;
+
+    listen();
+
+    int fds[2];
+    if (::pipe(fds) < 0)
+        throw std::system_error(errno, std::generic_category(), "failed to create the wake pipe");
+    wake_reader_.reset(fds[0]);
+    wake_writer_.reset(fds[1]);
+    if (!internal::set_nonblocking(wake_reader_.get()))
+        throw std::system_error(errno, std::generic_category(), "failed to make the wake pipe non-blocking");
+
+    running_ = true;
+    thread_ = std::thread([this]() { run(); });
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    char wake = 0;
+    while (::write(wake_writer_.get(), &wake, 1) < 0 && errno == EINTR);
+    thread_.join();
+
+    connections_.clear();
+    body_.reset();
+    gzipped_.reset();
+    listener_.reset();
+    wake_reader_.reset();
+    wake_writer_.reset();
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::run()
+{
+    std::vector<pollfd> polled;
+    while (running_)
+    {
+        auto now = clock::now();
+        auto timeout = -1;
+        polled.clear();
+        polled.push_back(pollfd{wake_reader_.get(), POLLIN, 0});
+        polled.push_back(pollfd{listener_.get(), static_cast<short>(connections_.size() < options_.max_connections ? POLLIN : 0), 0});
+        for (auto& connection : connections_)
+        {
+            short events = connection->pending.empty() ? POLLIN : POLLOUT;
+            polled.push_back(pollfd{connection->socket.get(), events, 0});
+
+            auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(connection->active + options_.idle_timeout - now).count();
+            auto wait = static_cast<int>(std::max<decltype(idle)>(0, std::min<decltype(idle)>(idle + 1, 60000)));
+            timeout = timeout < 0 ? wait : std::min(timeout, wait);
+        }
+
+        if (::poll(polled.data(), polled.size(), timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (polled[0].revents)
+        {
+            char drain[16];
+            while (::read(wake_reader_.get(), drain, sizeof(drain)) > 0);
+        }
+
+        now = clock::now();
+        ++pass_;
+        for (std::size_t i = 0; i < connections_.size(); i++)
+        {
+            auto& connection = *connections_[i];
+            auto events = polled[i + 2].revents;
+            if (events & POLLIN)
+                receive(connection, now);
+            else if (events & (POLLERR | POLLHUP | POLLNVAL))
+                connection.closed = true;
+
+            if (!connection.closed && !connection.pending.empty())
+                send(connection, now);
+            if (now - connection.active >= options_.idle_timeout)
+                connection.closed = true;
+        }
+
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(), [](const std::unique_ptr<internal::http_connection>& c) {
+            return c->closed;
+        }), connections_.end());
+
+        if (polled[1].revents & POLLIN)
+            accept_all(now);
+    }
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::accept_all(clock::time_point now)
+{
+    while (connections_.size() < options_.max_connections)
+    {
+        internal::file_handle socket(::accept(listener_.get(), nullptr, nullptr));
+        if (!socket)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+
+        if (!internal::set_nonblocking(socket.get()))
+            continue;
+
+        int on = 1;
+        ::setsockopt(socket.get(), IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        ::setsockopt(socket.get(), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+        connections_.emplace_back(std::make_unique<internal::http_connection>(std::move(socket), now));
+    }
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::receive(internal::http_connection& connection, clock::time_point now)
+{
+    // requests for metrics are small, so anything bigger than this isn't a scraper
+    static constexpr std::size_t max_request = 16384;
+
+    char buffer[4096];
+    auto hung_up = false;
+    while (true)
+    {
+        auto received = ::recv(connection.socket.get(), buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            connection.received.append(buffer, static_cast<std::size_t>(received));
+            connection.active = now;
+
+            // leave the rest in the socket until what's been read is handled, polling brings us back for it
+            if (connection.received.size() > max_request)
+                break;
+            continue;
+        }
+
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            connection.closed = true;
+            return;
+        }
+
+        hung_up = received == 0;
+        break;
+    }
+
+    std::size_t consumed = 0;
+    while (!connection.close_after_send)
+    {
+        auto end = connection.received.find("\r\n\r\n", consumed);
+        if (end == std::string::npos)
+        {
+            if (connection.received.size() - consumed > max_request)
+                respond_error(connection, "431 Request Header Fields Too Large");
+            break;
+        }
+
+        internal::http_request request;
+        if (!request.parse(connection.received.substr(consumed, end - consumed)))
+            respond_error(connection, "400 Bad Request");
+        else
+            respond(connection, request, now);
+        consumed = end + 4;
+    }
+
+    connection.received.erase(0, consumed);
+
+    // a scraper that's done sending still gets the responses to what it sent
+    if (hung_up)
+    {
+        connection.close_after_send = true;
+        connection.closed = connection.pending.empty();
+    }
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::respond(internal::http_connection& connection, const internal::http_request& request, clock::time_point now)
+{
+    auto head = request.method == "HEAD";
+    if (!head && request.method != "GET")
+    {
+        respond_error(connection, "405 Method Not Allowed");
+        return;
+    }
+    if (request.has_body)
+    {
+        respond_error(connection, "400 Bad Request");
+        return;
+    }
+    if (request.path != options_.path)
+    {
+        respond_error(connection, "404 Not Found");
+        return;
+    }
+
+    auto gzipped = options_.gzip && request.accepts_gzip;
+    std::shared_ptr<const std::string> body;
+    try
+    {
+        body = render(gzipped, now);
+    }
+    catch (...)
+    {
+        respond_error(connection, "500 Internal Server Error");
+        return;
+    }
+
+    auto headers = std::make_shared<std::string>();
+    headers->append("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+    if (gzipped)
+        headers->append("Content-Encoding: gzip\r\n");
+    headers->append("Content-Length: ").append(std::to_string(body->size()));
+    headers->append(request.keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+
+    connection.pending.emplace_back(std::move(headers));
+    if (!head)
+        connection.pending.emplace_back(body);
+    connection.close_after_send = !request.keep_alive;
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::respond_error(internal::http_connection& connection, const char* status)
+{
+    auto response = std::make_shared<std::string>("HTTP/1.1 ");
+    response->append(status).append("\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+
+    connection.pending.emplace_back(std::move(response));
+    connection.close_after_send = true;
+}
+
+template<typename TMetricRepo>
+void prometheus_http_server<TMetricRepo>::send(internal::http_connection& connection, clock::time_point now)
+{
+    while (!connection.pending.empty())
+    {
+        const auto& data = *connection.pending.front();
+        auto sent = ::send(connection.socket.get(), data.data() + connection.sent, data.size() - connection.sent, internal::send_flags);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                connection.closed = true;
+            return;
+        }
+
+        connection.active = now;
+        connection.sent += static_cast<std::size_t>(sent);
+        if (connection.sent == data.size())
+        {
+            connection.pending.pop_front();
+            connection.sent = 0;
+        }
+    }
+
+    if (connection.close_after_send)
+        connection.closed = true;
+}
+
+template<typename TMetricRepo>
+const std::shared_ptr<const std::string>& prometheus_http_server<TMetricRepo>::render(bool gzipped, clock::time_point now)
+{
+    if (!body_ || (rendered_pass_ != pass_ && now - rendered_at_ >= options_.coalesce_window))
+    {
+        auto body = std::make_shared<std::string>();
+        if (body_)
+            body->reserve(body_->size());
+        publisher_.write(*body);
+
+        body_ = std::move(body);
+        gzipped_.reset();
+        rendered_at_ = now;
+        rendered_pass_ = pass_;
+        renders_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+#ifdef CXXMETRICS_PROMETHEUS_ZLIB
+    if (gzipped)
+    {
+        if (!gzipped_)
+            gzipped_ = internal::gzip(*body_);
+        return gzipped_;
+    }
+#endif
+
+    return body_;
+}
+
+}
+
+#endif //CXXMETRICS_PROMETHEUS_HTTP_SERVER_HPP
@@ -1,7 +1,12 @@
 #ifndef CXXMETRICS_PROMETHEUS_PUBLISHER_HPP
 #define CXXMETRICS_PROMETHEUS_PUBLISHER_HPP
 
+#include <ostream>
+#include <string>
+#include <vector>
 #include <cxxmetrics/publisher.hpp>
+#include <cxxmetrics/snapshot_scheduler.hpp>
+#include "series_cache.hpp"
 #include "prometheus_counter.hpp"
 #include "prometheus_gauge.hpp"
 #include "prometheus_meter.hpp"
@@ -14,27 +19,104 @@ namespace cxxmetrics_prometheus
 template<typename TMetricRepo>
 class prometheus_publisher : public cxxmetrics::metrics_publisher<TMetricRepo>
 {
+    template<typename TVisit>
+    void write_metric(internal::text_writer& out, const cxxmetrics::metric_path& name, cxxmetrics::basic_registered_metric& metric, TVisit&& visit)
+    {
+        if (name.begin() == name.end())
+            return;
+
+        const auto& options = this->effective_options(metric);
+        auto& cache = this->template get_data_for<internal::series_cache>(metric);
+        auto lock = cache.begin(name);
+        bool header = false;
+
+        visit([&](const cxxmetrics::tag_collection& tags, const auto& snapshot) {
+            using snapshot_type = typename std::decay<decltype(snapshot)>::type;
+            snapshot_writer<snapshot_type> writer(out, name, cache.name(), header, options);
+            writer.write(cache.labels(tags), snapshot);
+        });
+
+        cache.end();
+    }
+
 public:
     prometheus_publisher(cxxmetrics::metrics_registry<TMetricRepo>& registry) :
             cxxmetrics::metrics_publisher<TMetricRepo>(registry)
     { }
 
-    void write(std::ostream& into)
+    /**
+     * \brief Append the prometheus text for every metric in the registry to a string
+     *
+     * The formatted names and labels of the series are cached on the metrics between calls, and nothing goes
+     * through a stream, so reusing the same string from one scrape to the next avoids nearly all allocation.
+     *
+     * \param into the string to append to
+     */
+    void write(std::string& into)
     {
-        this->visit_all([this, &into](const cxxmetrics::metric_path& name, cxxmetrics::basic_registered_metric& metric) {
-            const auto& options = this->effective_options(metric);
-            bool header = false;
-
-            if (name.begin() == name.end())
-                return;
-
-            metric.visit([&](const cxxmetrics::tag_collection& tags, const auto& snapshot) {
-                using snapshot_type = typename std::decay<decltype(snapshot)>::type;
-                snapshot_writer<snapshot_type> writer(into, name, header, options);
-                writer.write(tags, snapshot);
-            });
+        internal::text_writer out(into);
+        this->visit_all([this, &out](const cxxmetrics::metric_path& name, cxxmetrics::basic_registered_metric& metric) {
+            write_metric(out, name, metric, [&metric](auto&& handler) { metric.visit(handler); });
         });
     }
+
+    /**
+     * \brief Append the prometheus text for snapshots that were already taken of the registry
+     *
+     * Nothing is snapshotted while writing, so this is the cheap way to publish what a snapshot_scheduler took.
+     *
+     * \param into the string to append to
+     * \param snapshots the snapshots to write, which must have been taken of this publisher's registry
+     */
+    void write(std::string& into, const cxxmetrics::snapshot_set& snapshots)
+    {
+        internal::text_writer out(into);
+        for (const auto& metric : snapshots)
+            write_metric(out, metric.path(), metric.registered(), [&metric](auto&& handler) { metric.visit(handler); });
+    }
+
+    /**
+     * \brief Append the prometheus text for snapshots that were already taken, splitting the writing across threads
+     *
+     * Each range of metrics is written into a buffer of its own, and the buffers are appended in order, so the text
+     * is the same as writing the snapshots on one thread.
+     *
+     * \param into the string to append to
+     * \param snapshots the snapshots to write, which must have been taken of this publisher's registry
+     * \param workers the threads to write the text on
+     */
+    void write(std::string& into, const cxxmetrics::snapshot_set& snapshots, cxxmetrics::worker_pool& workers)
+    {
+        std::vector<std::string> buffers(workers.partitions(snapshots.size()));
+        workers.partition(snapshots.size(), [this, &buffers, &snapshots](std::size_t index, std::size_t begin, std::size_t end) {
+            internal::text_writer out(buffers[index]);
+            for (auto i = begin; i < end; i++)
+            {
+                const auto& metric = snapshots[i];
+                write_metric(out, metric.path(), metric.registered(), [&metric](auto&& handler) { metric.visit(handler); });
+            }
+        });
+
+        std::size_t size = into.size();
+        for (const auto& buffer : buffers)
+            size += buffer.size();
+
+        into.reserve(size);
+        for (const auto& buffer : buffers)
+            into.append(buffer);
+    }
+
+    /**
+     * \brief Write the prometheus text for every metric in the registry to a stream
+     */
+    void write(std::ostream& into)
+    {
+        // each thread keeps its buffer so repeated scrapes don't reallocate it
+        static thread_local std::string buffer;
+        buffer.clear();
+        write(buffer);
+        into.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
 };
 
 }
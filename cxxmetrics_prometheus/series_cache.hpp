@@ -0,0 +1,91 @@
+#ifndef CXXMETRICS_PROMETHEUS_SERIES_CACHE_HPP
+#define CXXMETRICS_PROMETHEUS_SERIES_CACHE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <cxxmetrics/publisher.hpp>
+#include "text_writer.hpp"
+
+namespace cxxmetrics_prometheus
+{
+
+namespace internal
+{
+
+/**
+ * \brief The prometheus formatted name of a registered metric and the formatted labels of each of its series
+ *
+ * The cache is kept on the registered metric as publisher data so the escaping only happens the first time a series
+ * is published. Series that weren't published in the latest scrape, like permutations the registry has dropped, are
+ * forgotten at the end of it.
+ */
+class series_cache : public cxxmetrics::basic_publish_options
+{
+    struct series
+    {
+        std::string labels;
+        std::uint64_t scrape = 0;
+    };
+
+    std::mutex lock_;
+    std::string name_;
+    std::unordered_map<cxxmetrics::tag_collection, series> series_;
+    std::uint64_t scrape_ = 0;
+
+public:
+    /**
+     * \brief Start publishing the metric, holding the cache for the scrape until the returned lock is released
+     */
+    std::unique_lock<std::mutex> begin(const cxxmetrics::metric_path& path)
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        if (name_.empty())
+            format_name(name_, path);
+        ++scrape_;
+
+        return lock;
+    }
+
+    /**
+     * \brief Get the formatted name of the metric
+     */
+    const std::string& name() const noexcept
+    {
+        return name_;
+    }
+
+    /**
+     * \brief Get the formatted labels of a series, without the surrounding braces
+     */
+    const std::string& labels(const cxxmetrics::tag_collection& tags)
+    {
+        auto& s = series_[tags];
+        if (s.scrape == 0)
+            format_tags(s.labels, tags);
+        s.scrape = scrape_;
+
+        return s.labels;
+    }
+
+    /**
+     * \brief Finish publishing the metric, forgetting the series that weren't published
+     */
+    void end()
+    {
+        for (auto itr = series_.begin(); itr != series_.end();)
+        {
+            if (itr->second.scrape != scrape_)
+                itr = series_.erase(itr);
+            else
+                ++itr;
+        }
+    }
+};
+
+}
+
+}
+
+#endif //CXXMETRICS_PROMETHEUS_SERIES_CACHE_HPP
@@ -0,0 +1,219 @@
+#ifndef CXXMETRICS_PROMETHEUS_TEXT_WRITER_HPP
+#define CXXMETRICS_PROMETHEUS_TEXT_WRITER_HPP
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <cxxmetrics/metric_path.hpp>
+#include <cxxmetrics/metric_value.hpp>
+#include <cxxmetrics/tag_collection.hpp>
+
+namespace cxxmetrics_prometheus
+{
+
+namespace internal
+{
+
+/**
+ * \brief Appends the pieces of the prometheus text format to a string without going through a stream
+ *
+ * The string is the caller's, so a buffer can be reused from one scrape to the next without reallocating. Integers
+ * are formatted two digits at a time, and floating point values are written with the same six decimal places the
+ * library formats them with elsewhere, less any trailing zeros.
+ */
+class text_writer
+{
+    std::string& out_;
+
+    void append_unsigned(unsigned long long value)
+    {
+        static const char digits[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+
+        char buf[20];
+        char* end = buf + sizeof(buf);
+        char* at = end;
+        while (value >= 100)
+        {
+            auto i = (value % 100) * 2;
+            value /= 100;
+            *--at = digits[i + 1];
+            *--at = digits[i];
+        }
+
+        if (value < 10)
+            *--at = static_cast<char>('0' + value);
+        else
+        {
+            *--at = digits[value * 2 + 1];
+            *--at = digits[value * 2];
+        }
+
+        out_.append(at, end - at);
+    }
+
+    void append_signed(long long value)
+    {
+        if (value < 0)
+        {
+            out_.push_back('-');
+            append_unsigned(0ull - static_cast<unsigned long long>(value));
+        }
+        else
+            append_unsigned(static_cast<unsigned long long>(value));
+    }
+
+    void append_float(long double value)
+    {
+        if (std::isnan(value))
+        {
+            out_.append("NaN");
+            return;
+        }
+        if (std::isinf(value))
+        {
+            out_.append(value > 0 ? "+Inf" : "-Inf");
+            return;
+        }
+
+        bool negative = value < 0;
+        if (negative)
+            value = -value;
+
+        // too big for the integer part to fit in a long long
+        if (value >= 1e18L)
+        {
+            char buf[64];
+            auto len = std::snprintf(buf, sizeof(buf), negative ? "-%Lg" : "%Lg", value);
+            out_.append(buf, static_cast<std::size_t>(len));
+            return;
+        }
+
+        auto whole = static_cast<unsigned long long>(value);
+        auto fraction = static_cast<unsigned long long>(std::llround((value - whole) * 1000000.0L));
+        if (fraction >= 1000000)
+        {
+            ++whole;
+            fraction -= 1000000;
+        }
+
+        if (negative && (whole || fraction))
+            out_.push_back('-');
+        append_unsigned(whole);
+        if (fraction == 0)
+            return;
+
+        char buf[7];
+        buf[0] = '.';
+        for (int i = 6; i > 0; i--)
+        {
+            buf[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+
+        std::size_t len = sizeof(buf);
+        while (buf[len - 1] == '0')
+            --len;
+        out_.append(buf, len);
+    }
+
+public:
+    explicit text_writer(std::string& out) noexcept :
+            out_(out)
+    { }
+
+    /**
+     * \brief Get the string being written to
+     */
+    std::string& str() noexcept { return out_; }
+
+    text_writer& operator<<(char c) { out_.push_back(c); return *this; }
+    text_writer& operator<<(const char* str) { out_.append(str); return *this; }
+    text_writer& operator<<(const std::string& str) { out_.append(str); return *this; }
+
+    text_writer& operator<<(int value) { append_signed(value); return *this; }
+    text_writer& operator<<(long value) { append_signed(value); return *this; }
+    text_writer& operator<<(long long value) { append_signed(value); return *this; }
+    text_writer& operator<<(unsigned value) { append_unsigned(value); return *this; }
+    text_writer& operator<<(unsigned long value) { append_unsigned(value); return *this; }
+    text_writer& operator<<(unsigned long long value) { append_unsigned(value); return *this; }
+    text_writer& operator<<(double value) { append_float(value); return *this; }
+    text_writer& operator<<(long double value) { append_float(value); return *this; }
+
+    text_writer& operator<<(const cxxmetrics::metric_value& value)
+    {
+        value.visit([this](const auto& v) { *this << v; });
+        return *this;
+    }
+};
+
+inline void format_name_element(std::string& into, const std::string& element)
+{
+    for (auto c : element)
+        into.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+}
+
+inline void format_name(std::string& into, const cxxmetrics::metric_path& path)
+{
+    auto elem = path.begin();
+    if (std::isdigit(static_cast<unsigned char>((*elem)[0])))
+        into.push_back('_');
+
+    format_name_element(into, *elem);
+    for (++elem; elem != path.end(); ++elem)
+    {
+        into.push_back(':');
+        format_name_element(into, *elem);
+    }
+}
+
+inline void format_label_name(std::string& into, const std::string& name)
+{
+    if (!name.empty() && std::isdigit(static_cast<unsigned char>(name[0])))
+        into.push_back('_');
+
+    format_name_element(into, name);
+}
+
+inline void format_tag_value(std::string& into, const std::string& value)
+{
+    for (auto c : value)
+    {
+        if (c == '"')
+            into.append("\\\"");
+        else if (c == '\\')
+            into.append("\\\\");
+        else if (c == '\n')
+            into.append("\\n");
+        else
+            into.push_back(c);
+    }
+}
+
+/**
+ * \brief Write the tags of a series as prometheus labels, without the surrounding braces
+ */
+inline void format_tags(std::string& into, const cxxmetrics::tag_collection& tags)
+{
+    bool first = true;
+    for (const auto& tag : tags)
+    {
+        if (!first)
+            into.push_back(',');
+        first = false;
+
+        format_label_name(into, tag.first);
+        into.append("=\"");
+        format_tag_value(into, static_cast<std::string>(tag.second));
+        into.push_back('"');
+    }
+}
+
+}
+
+}
+
+#endif //CXXMETRICS_PROMETHEUS_TEXT_WRITER_HPP
@@ -0,0 +1,66 @@
+#include <catch2/catch.hpp>
+#include <thread>
+#include <cxxmetrics/coarse_clock.hpp>
+#include <cxxmetrics/ewma.hpp>
+#include <cxxmetrics/meter.hpp>
+#include <cxxmetrics/sliding_window.hpp>
+
+using namespace std::chrono_literals;
+using namespace cxxmetrics;
+using namespace cxxmetrics_literals;
+
+TEST_CASE("Coarse clock follows the steady clock", "[coarse_clock]")
+{
+    auto before = std::chrono::steady_clock::now();
+    auto first = coarse_clock::now();
+    REQUIRE(first - before < 50ms);
+    REQUIRE(before - first < 50ms);
+
+    std::this_thread::sleep_for(20ms);
+    auto second = coarse_clock::now();
+
+    auto after = std::chrono::steady_clock::now();
+    REQUIRE(second > first);
+    REQUIRE(second - after < 50ms);
+    REQUIRE(after - second < 50ms);
+}
+
+TEST_CASE("Coarse clock point is usable as a metric clock", "[coarse_clock]")
+{
+    clocked_meter<coarse_clock_point, 1_msec, 1_sec, 1_min> m;
+    ewma<1_sec, 1_msec, double, coarse_clock_point> e;
+    sliding_window_reservoir<int, 16, coarse_clock_point> r(1_sec);
+
+    for (int i = 0; i < 10; i++)
+    {
+        m.mark(10);
+        e.mark(10);
+        r.update(i);
+    }
+    std::this_thread::sleep_for(5ms);
+
+    REQUIRE(m.rate<1_sec>().rate > 0);
+    REQUIRE(m.mean() > 0);
+    REQUIRE(e.rate() > 0);
+    REQUIRE(r.snapshot().size() == 10);
+}
+
+TEST_CASE("Coarse clock read benchmark", "[.][benchmark][coarse_clock]")
+{
+    constexpr int reads = 10000000;
+    long long total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++)
+        total += std::chrono::steady_clock::now().time_since_epoch().count() & 1;
+    auto steady = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++)
+        total += coarse_clock::now().time_since_epoch().count() & 1;
+    auto coarse = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(total >= 0);
+    WARN(reads << " steady_clock reads took " << std::chrono::duration_cast<std::chrono::milliseconds>(steady).count() << "ms, coarse_clock reads took "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(coarse).count() << "ms");
+}
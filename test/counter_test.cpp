@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include <cxxmetrics/counter.hpp>
+#include <cxxmetrics/striped_counter.hpp>
 
 using namespace cxxmetrics;
 
@@ -29,3 +30,37 @@ TEST_CASE("Counter excercise snapshot", "[counter]")
     counter<double> a(15.7);
     REQUIRE(a.snapshot() == 15.7);
 }
+
+TEST_CASE("Counter updates stamp the change generation", "[counter]")
+{
+    counter<int64_t> a;
+    auto since = internal::change_generation::advance();
+    REQUIRE(a.changed_generation() < since);
+
+    a += 0;
+    REQUIRE(a.changed_generation() == since);
+
+    internal::change_generation::advance();
+    a = 5;
+    REQUIRE(a.changed_generation() > since);
+}
+
+TEST_CASE("Striped counter updates stamp the change generation", "[counter]")
+{
+    striped_counter<int64_t> a;
+    auto since = internal::change_generation::advance();
+    REQUIRE(a.changed_generation() < since);
+
+    a += 5;
+    REQUIRE(a.changed_generation() == since);
+
+    since = internal::change_generation::advance();
+    a = 2;
+    REQUIRE(a.changed_generation() == since);
+
+    since = internal::change_generation::advance();
+    striped_counter<int64_t> b(7);
+    a = std::move(b);
+    REQUIRE(a.changed_generation() == since);
+    REQUIRE(b.changed_generation() == since);
+}
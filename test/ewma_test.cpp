@@ -134,3 +134,52 @@ TEST_CASE("EWMA excercise snapshot", "[ewma]")
     ewma<10_sec, 5_sec, double> e;
     REQUIRE(e.snapshot() == 0);
 }
+
+TEST_CASE("EWMA decays exactly over idle intervals", "[ewma]")
+{
+    unsigned clock = 1;
+    mock_ewma<10, 1> e(clock);
+    mock_ewma<10, 1> later(clock);
+
+    for (int i = 0; i <= 10; i++)
+    {
+        e.mark(7);
+        later.mark(7);
+        clock++;
+    }
+
+    // with alpha = 1 - e^(-1/20), ten more idle intervals decays by (1 - alpha)^10 = e^(-1/2)
+    auto start = clock;
+    clock = start + 50;
+    auto rate = e.rate();
+    clock = start + 60;
+    auto later_rate = later.rate();
+
+    REQUIRE(rate > 0);
+    REQUIRE(later_rate == Approx(rate * std::exp(-0.5)));
+
+    clock += 100000;
+    REQUIRE(e.rate() >= 0);
+    REQUIRE(e.rate() < 0.0001);
+}
+
+TEST_CASE("EWMA read after long idle benchmark", "[.][benchmark][ewma]")
+{
+    unsigned clock = 1;
+    std::vector<mock_ewma<60000000, 1000000>> ewmas(100000, mock_ewma<60000000, 1000000>(clock));
+
+    for (auto& e : ewmas)
+        e.mark(5);
+
+    // an hour of silence
+    clock += 3600000000u;
+
+    auto start = std::chrono::steady_clock::now();
+    double total = 0;
+    for (auto& e : ewmas)
+        total += e.rate();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(total >= 0);
+    WARN("reading 100000 ewmas after an hour idle took " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us");
+}
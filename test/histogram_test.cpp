@@ -27,3 +27,33 @@ TEST_CASE("Histogram sanity check", "[histogram]")
     REQUIRE_THAT(s.mean(), Catch::WithinULP(28.0, 1));
     REQUIRE(s.count() == 8);
 }
+
+TEST_CASE("Histogram snapshots merge", "[histogram]")
+{
+    histogram<int, simple_reservoir<int, 5>> a;
+    histogram<int, simple_reservoir<int, 5>> b;
+
+    for (int i = 1; i <= 5; i++)
+    {
+        a.update(i);
+        b.update(i + 5);
+    }
+
+    auto s = a.snapshot();
+    s.merge(b.snapshot());
+
+    REQUIRE(s.size() == 10);
+    REQUIRE(s.count() == 10);
+    REQUIRE(s.min() == metric_value(1));
+    REQUIRE(s.max() == metric_value(10));
+    REQUIRE(s.mean() == metric_value(5.5));
+
+    // snapshots from reservoirs of different types get merged as metric values
+    histogram<double, simple_reservoir<double, 5>> c;
+    c.update(20.5);
+    s.merge(c.snapshot());
+
+    REQUIRE(s.size() == 11);
+    REQUIRE(s.count() == 11);
+    REQUIRE(s.max() == metric_value(20.5));
+}
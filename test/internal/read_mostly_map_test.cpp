@@ -0,0 +1,141 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <cxxmetrics/internal/read_mostly_map.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxxmetrics::internal;
+
+TEST_CASE("read_mostly_map finds what was added", "[read_mostly_map]")
+{
+    read_mostly_map<std::string, int> map;
+    REQUIRE(map.find("one") == nullptr);
+
+    int built = 0;
+    auto& one = map.get_or_add("one", [&built]() { ++built; return 1; });
+    auto& again = map.get_or_add("one", [&built]() { ++built; return 2; });
+
+    REQUIRE(&one == &again);
+    REQUIRE(one == 1);
+    REQUIRE(built == 1);
+    REQUIRE(map.size() == 1);
+    REQUIRE(map.find("one") == &one);
+
+    auto entry = map.find_entry("one", map.hash("one"));
+    REQUIRE(entry.second == &one);
+    REQUIRE(entry.first == map.get_or_add_entry("one", map.hash("one"), []() { return 3; }).first);
+    REQUIRE(map.find_entry("two", map.hash("two")).first == nullptr);
+
+    const char* chars = "one and more";
+    auto prefix = [chars](const std::string& key) { return key.compare(0, key.size(), chars, 3) == 0; };
+    REQUIRE(map.find_matching(map.hash("one"), prefix) == &one);
+    REQUIRE(map.find_matching(map.hash("two"), prefix) == nullptr);
+}
+
+TEST_CASE("read_mostly_map keeps values in place as it grows", "[read_mostly_map]")
+{
+    read_mostly_map<int, int> map;
+    std::vector<int*> values;
+
+    for (int i = 0; i < 1000; i++)
+        values.push_back(&map.get_or_add(i, [i]() { return i * 2; }));
+
+    REQUIRE(map.size() == 1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(map.find(i) == values[i]);
+        REQUIRE(*values[i] == i * 2);
+    }
+
+    int visited = 0;
+    long long total = 0;
+    map.each([&](const int& key, int& value) {
+        ++visited;
+        total += value;
+    });
+
+    REQUIRE(visited == 1000);
+    REQUIRE(total == 999000);
+
+    int checked = 0;
+    REQUIRE(map.any([&checked](const int& key, const int&) { ++checked; return key % 10 == 3; }));
+    REQUIRE(checked < 1000);
+    REQUIRE_FALSE(map.any([](const int&, const int& value) { return value < 0; }));
+}
+
+TEST_CASE("read_mostly_map concurrent adds and finds agree", "[read_mostly_map]")
+{
+    read_mostly_map<int, int> map;
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&map, &mismatches, t]() {
+            for (int i = 0; i < 2000; i++)
+            {
+                auto& v = map.get_or_add(i, [i]() { return i; });
+                auto found = map.find(i);
+                if (v != i || found == nullptr || found != &v)
+                    mismatches[t]++;
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+
+    REQUIRE(map.size() == 2000);
+    for (auto m : mismatches)
+        REQUIRE(m == 0);
+}
+
+TEST_CASE("read_mostly_map removes what the predicate matches", "[read_mostly_map]")
+{
+    read_mostly_map<int, int> map;
+    for (int i = 0; i < 1000; i++)
+        map.get_or_add(i, [i]() { return i; });
+
+    auto removed = map.remove_if([](const int& key, int&) { return key % 10 != 0; });
+
+    REQUIRE(removed == 900);
+    REQUIRE(map.size() == 100);
+    for (int i = 0; i < 1000; i++)
+        REQUIRE((map.find(i) != nullptr) == (i % 10 == 0));
+
+    // removed keys can be added again
+    REQUIRE(map.get_or_add(5, []() { return 50; }) == 50);
+    REQUIRE(map.size() == 101);
+    REQUIRE(map.remove_if([](const int&, int&) { return false; }) == 0);
+}
+
+TEST_CASE("read_mostly_map guarded readers survive concurrent removal", "[read_mostly_map]")
+{
+    read_mostly_map<int, std::shared_ptr<int>> map;
+    std::atomic<bool> running(true);
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(3, 0);
+
+    for (int t = 0; t < 3; t++)
+        threads.emplace_back([&, t]() {
+            while (running.load())
+            {
+                for (int i = 0; i < 64; i++)
+                {
+                    read_mostly_guard guard;
+                    auto& value = map.get_or_add(i, [i]() { return std::make_shared<int>(i); });
+                    if (*value != i)
+                        ++mismatches[t];
+                }
+            }
+        });
+
+    for (int sweep = 0; sweep < 200; sweep++)
+        map.remove_if([sweep](const int& key, std::shared_ptr<int>&) { return key % 2 == sweep % 2; });
+
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    for (auto m : mismatches)
+        REQUIRE(m == 0);
+}
@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
+#include <atomic>
 #include <thread>
+#include <vector>
 #include <cxxmetrics/meter.hpp>
 #include <ctti/type_id.hpp>
 #include "helpers.hpp"
@@ -81,3 +83,83 @@ TEST_CASE("Meter snapshot", "[meter]")
     REQUIRE(ss.value() != metric_value(0.0));
 }
 
+
+TEST_CASE("Meter windows match a standalone ewma", "[meter]")
+{
+    unsigned clock = 1;
+    mock_clock clk(clock);
+
+    internal::_meter_impl<mock_clock, 1, 4, 16> m(clk);
+    internal::ewma<mock_clock, 4, 1, double> four(clk);
+    internal::ewma<mock_clock, 16, 1, double> sixteen(clk);
+
+    for (int i = 0; i < 50; i++)
+    {
+        m.mark(i % 7);
+        four.mark(i % 7);
+        sixteen.mark(i % 7);
+        clock += (i % 5 == 0) ? 3 : 1;
+    }
+
+    REQUIRE(m.get_rate<4>() == Approx(four.rate()));
+    REQUIRE(m.get_rate<16>() == Approx(sixteen.rate()));
+}
+
+TEST_CASE("Meter counts every concurrent mark", "[meter]")
+{
+    meter<1_micro, 1_min, 5_min, 15_min> m;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&m]() {
+            for (int i = 0; i < 10000; i++)
+                m.mark(1);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    std::this_thread::sleep_for(10us);
+    REQUIRE(m.mean() > 0);
+    REQUIRE(m.rate<1_min>().rate > 0);
+}
+
+TEST_CASE("Meter total never goes backwards while marks are being folded", "[meter]")
+{
+    internal::meter_windows<default_clock_point, 1_micro, 1_min> m((default_clock_point()));
+    std::atomic<bool> running(true);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 2; t++)
+        threads.emplace_back([&m, &running]() {
+            while (running.load(std::memory_order_relaxed))
+                m.mark(1);
+        });
+
+    int64_t last = 0;
+    int backwards = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        auto total = m.total();
+        if (total < last)
+            backwards++;
+        last = total;
+    }
+
+    running = false;
+    for (auto& t : threads)
+        t.join();
+    REQUIRE(backwards == 0);
+}
+
+TEST_CASE("Meter mark benchmark", "[.][benchmark][meter]")
+{
+    meter<5_sec, 1_min, 5_min, 15_min, 1_hour, 24_hour> m;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10000000; i++)
+        m.mark(1);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(m.mean() > 0);
+    WARN("10000000 marks across 5 windows took " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms");
+}
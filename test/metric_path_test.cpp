@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <vector>
+#include <cxxmetrics/metric_path.hpp>
+
+using namespace cxxmetrics;
+using namespace cxxmetrics_literals;
+
+static_assert(internal::fnv1a("requests") == internal::fnv1a("requests", 8), "literal hashes are available at compile time");
+
+TEST_CASE("Metric paths built different ways are the same", "[metric_path]")
+{
+    std::string served = "served";
+    metric_path a = "requests"_m/"api"/"served";
+    metric_path b = "requests"/("api"_m/metric_path(served));
+    metric_path c = metric_path("requests")/metric_path("api", 3)/metric_path(served.c_str());
+
+    REQUIRE(a == b);
+    REQUIRE(b == c);
+    REQUIRE(std::hash<metric_path>()(a) == std::hash<metric_path>()(c));
+    REQUIRE(a != "requests"_m/"api");
+    REQUIRE(a != "requests"_m/"served"/"api");
+    REQUIRE(a.join(".") == "requests.api.served");
+}
+
+TEST_CASE("Metric paths iterate their segments", "[metric_path]")
+{
+    metric_path path = "a"_m/"bb"/""/"ccc";
+
+    std::vector<std::string> segments(path.begin(), path.end());
+    REQUIRE(segments == std::vector<std::string>{"a", "bb", "ccc"});
+    REQUIRE(path.size() == 3);
+    REQUIRE(metric_path("").size() == 0);
+    REQUIRE(metric_path("").join(".") == "");
+}
+
+TEST_CASE("Metric paths deeper than the inline segments", "[metric_path]")
+{
+    metric_path path = "root";
+    for (int i = 0; i < 20; i++)
+        path = path/metric_path("level" + std::to_string(i));
+
+    metric_path copy = path;
+    REQUIRE(copy.size() == 21);
+    REQUIRE(copy == path);
+    REQUIRE(copy.join("/").substr(0, 18) == "root/level0/level1");
+}
+
+TEST_CASE("Metric path hash and compare benchmark", "[.][benchmark][metric_path]")
+{
+    constexpr int iterations = 1000000;
+    std::size_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        auto path = "service"_m/"requests"/"served";
+        total += std::hash<metric_path>()(path) + (path == "service"_m/"requests"/"served");
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(total != 1);
+    WARN(iterations << " builds, hashes and compares of a 3 segment path took " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms");
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cxxmetrics/metric_value.hpp>
+
+using namespace cxxmetrics;
+using namespace std::chrono_literals;
+
+TEST_CASE("Metric value conversions", "[metric_value]")
+{
+    REQUIRE(static_cast<int>(metric_value(15)) == 15);
+    REQUIRE(static_cast<double>(metric_value(15.5)) == 15.5);
+    REQUIRE(static_cast<int>(metric_value(15.6)) == 16);
+    REQUIRE(static_cast<int>(metric_value("42")) == 42);
+    REQUIRE(static_cast<std::string>(metric_value(42u)) == "42");
+    REQUIRE(static_cast<std::string>(metric_value("hello")) == "hello");
+
+    // durations keep their own units
+    REQUIRE(static_cast<int>(metric_value(15ms)) == 15);
+    REQUIRE(static_cast<std::string>(metric_value(15ms)) == "15");
+    REQUIRE(metric_value(15ms) == metric_value(15000us));
+}
+
+TEST_CASE("Metric value comparisons", "[metric_value]")
+{
+    REQUIRE(metric_value(1) < metric_value(2));
+    REQUIRE(metric_value(2u) > metric_value(-1));
+    REQUIRE(metric_value(-1) < metric_value(2u));
+    REQUIRE(metric_value(1.5) > metric_value(1));
+    REQUIRE(metric_value(1) < metric_value(1.5));
+    REQUIRE(metric_value(2) == metric_value(2.0));
+    REQUIRE(metric_value("abc") < metric_value("abd"));
+    REQUIRE(metric_value("10") == metric_value(10));
+    REQUIRE(metric_value(1s) == metric_value(1000ms));
+    REQUIRE(metric_value(999ms) < metric_value(1s));
+}
+
+TEST_CASE("Metric value arithmetic", "[metric_value]")
+{
+    REQUIRE(metric_value(5) + metric_value(7) == metric_value(12));
+    REQUIRE(metric_value(5) - metric_value(7) == metric_value(-2));
+    REQUIRE(metric_value(5) * metric_value(1.5) == metric_value(7.5));
+    REQUIRE(metric_value(10) / metric_value(4) == metric_value(2));
+    REQUIRE(metric_value(10.0) / metric_value(4) == metric_value(2.5));
+    REQUIRE(metric_value(10) / metric_value(0) == metric_value(0));
+    REQUIRE(-metric_value(5) == metric_value(-5));
+    REQUIRE(~metric_value(0) == metric_value(-1));
+    REQUIRE(static_cast<std::string>(metric_value("ab") + metric_value("c")) == "abc");
+
+    // the left hand side decides the units
+    auto d = metric_value(500ms) + metric_value(1s);
+    REQUIRE(static_cast<int>(d) == 1500);
+    REQUIRE(d == metric_value(1500ms));
+    REQUIRE(metric_value(10ms) * metric_value(3) == metric_value(30ms));
+}
+
+TEST_CASE("Metric value keeps the fraction of floating point durations", "[metric_value]")
+{
+    using fmillis = std::chrono::duration<double, std::milli>;
+    metric_value subject(fmillis(1.5));
+
+    REQUIRE(static_cast<double>(subject) == 1.5);
+    REQUIRE(subject == metric_value(1500us));
+    REQUIRE(subject > metric_value(1ms));
+    REQUIRE(subject < metric_value(2ms));
+    REQUIRE(subject == metric_value(fmillis(1.5)));
+    REQUIRE(metric_value(fmillis(0.25)) < metric_value(fmillis(0.5)));
+
+    REQUIRE(static_cast<double>(subject + metric_value(500us)) == 2.0);
+    REQUIRE(metric_value(1ms) + subject == metric_value(2500us));
+    REQUIRE(subject * metric_value(2) == metric_value(3ms));
+    REQUIRE(subject / metric_value(3) == metric_value(500us));
+    REQUIRE(-subject == metric_value(-1500us));
+}
+
+TEST_CASE("Metric value copies and moves strings", "[metric_value]")
+{
+    metric_value a("a fairly long string that won't fit in the small string buffer");
+    metric_value b(a);
+    metric_value c(std::move(a));
+    REQUIRE(b == c);
+
+    b = metric_value(5);
+    REQUIRE(b == metric_value(5));
+    c = std::move(b);
+    REQUIRE(c == metric_value(5));
+    REQUIRE(std::hash<metric_value>()(metric_value("x")) == std::hash<metric_value>()(metric_value("x")));
+}
+
+TEST_CASE("Metric value sort benchmark", "[.][benchmark][metric_value]")
+{
+    std::mt19937_64 gen(1234);
+    std::uniform_int_distribution<int> dist(0, 1000000);
+
+    for (std::size_t size : {1024, 16384, 65536})
+    {
+        std::vector<metric_value> values;
+        values.reserve(size);
+        for (std::size_t i = 0; i < size; i++)
+            values.emplace_back(dist(gen));
+
+        auto start = std::chrono::steady_clock::now();
+        std::sort(values.begin(), values.end());
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        REQUIRE(std::is_sorted(values.begin(), values.end()));
+        WARN("sorting " << size << " values took " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us");
+    }
+}
@@ -1,9 +1,12 @@
 #include <catch2/catch.hpp>
+#include <random>
 #include <thread>
+#include <vector>
 #include <cxxmetrics/metrics_registry.hpp>
 #include <cxxmetrics/simple_reservoir.hpp>
 #include <cxxmetrics/uniform_reservoir.hpp>
 #include <cxxmetrics/sliding_window.hpp>
+#include <cxxmetrics/hdr_reservoir.hpp>
 
 using namespace std::chrono_literals;
 using namespace cxxmetrics;
@@ -182,6 +185,35 @@ TEST_CASE("Registry histogram aggregation", "[metrics_registry]")
     REQUIRE(count == 300);
 }
 
+TEST_CASE("Registry hdr histogram aggregation merges counts", "[metrics_registry]")
+{
+    using reservoir = hdr_reservoir<int64_t, 1, 1000000, 3>;
+    metrics_registry<> subject;
+    auto& h1 = *subject.histogram("histogram"_m, reservoir(), {{"mytag","tagvalue"}});
+    auto& h2 = *subject.histogram("histogram"_m, reservoir(), {{"mytag","tagvalue2"}});
+
+    for (int i = 1; i <= 1000; i++)
+    {
+        h1.update(i);
+        h2.update(i + 1000);
+    }
+
+    metric_value p50(0);
+    metric_value max(0);
+    std::size_t size = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.aggregate([&](const histogram_snapshot& ss) {
+            p50 = ss.value<50_p>();
+            max = ss.max();
+            size = ss.size();
+        });
+    });
+
+    REQUIRE(size == 2000);
+    REQUIRE(max == metric_value(2000));
+    REQUIRE(std::abs(static_cast<double>(p50) - 1000.0) < 1.0);
+}
+
 TEST_CASE("Registry meter aggregation", "[metrics_registry]")
 {
     metrics_registry<> subject;
@@ -227,3 +259,556 @@ TEST_CASE("Registry meter aggregation", "[metrics_registry]")
     REQUIRE(ceil(m100 / metric_value(1000.0)) == 9);
     REQUIRE(ceil(m200 / metric_value(1000.0)) == 9);
 }
+
+TEST_CASE("Registry striped counters aggregate like counters", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    auto* counter = subject.striped_counter("MyStripedCounter").get();
+    REQUIRE(counter == subject.striped_counter("MyStripedCounter").get());
+    REQUIRE_THROWS_AS(subject.counter("MyStripedCounter"), metric_type_mismatch);
+
+    *counter += 10;
+    *subject.striped_counter("MyStripedCounter", {{"mytag","tagvalue"}}) += 45;
+
+    int total = 0;
+    subject.visit_registered_metrics([&total](const metric_path& path, basic_registered_metric& metric) {
+        metric.aggregate([&total](const cumulative_value_snapshot& ctr) {
+            total = ctr.value();
+        });
+    });
+
+    REQUIRE(total == 55);
+}
+
+TEST_CASE("Registry with a read mostly repository", "[metrics_registry]")
+{
+    metrics_registry<read_mostly_repository> subject;
+    auto* counter = subject.counter("MyCounter").get();
+    REQUIRE(counter == subject.counter("MyCounter").get());
+    REQUIRE(counter != subject.counter("MyCounter", {{"mytag","tagvalue"}}).get());
+    REQUIRE_THROWS_AS(subject.counter<short>("MyCounter"), metric_type_mismatch);
+
+    *counter += 10;
+    *subject.counter("MyCounter", {{"mytag","tagvalue"}}) += 45;
+    subject.ewma<1_min>("MyEwma");
+
+    int names = 0;
+    int total = 0;
+    subject.visit_registered_metrics([&total, &names](const metric_path& path, basic_registered_metric& metric) {
+        ++names;
+        if (path == metric_path("MyCounter"))
+            metric.aggregate([&total](const value_snapshot& ctr) {
+                total = ctr.value();
+            });
+    });
+
+    REQUIRE(names == 2);
+    REQUIRE(total == 55);
+}
+
+TEST_CASE("Registry with a sharded repository", "[metrics_registry]")
+{
+    metrics_registry<sharded_repository<4>> subject;
+    auto* counter = subject.counter("MyCounter").get();
+    REQUIRE(counter == subject.counter("MyCounter").get());
+    REQUIRE_THROWS_AS(subject.counter<short>("MyCounter"), metric_type_mismatch);
+
+    for (int i = 0; i < 20; i++)
+        *subject.counter("counters"_m/std::to_string(i)) += i;
+
+    // visiting doesn't hold a shard's lock while the handler runs, so the handler can register metrics
+    int names = 0;
+    int total = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        ++names;
+        subject.counter("visited"_m/path);
+        metric.aggregate([&total](const value_snapshot& ctr) {
+            total += static_cast<int>(ctr.value());
+        });
+    });
+
+    // metrics registered in shards that haven't been visited yet get visited too
+    REQUIRE(names >= 21);
+    REQUIRE(names <= 42);
+    REQUIRE(total == 190);
+}
+
+template<typename TRepository>
+static long long concurrent_lookup_ns(int threadcount, int lookups)
+{
+    metrics_registry<TRepository> subject;
+    const tag_collection tags{{"service", "api"}, {"status", 200}};
+    subject.counter("requests", tags);
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadcount; t++)
+        threads.emplace_back([&subject, &tags, lookups]() {
+            for (int i = 0; i < lookups; i++)
+                *subject.counter("requests", tags) += 1;
+        });
+    for (auto& t : threads)
+        t.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (static_cast<long long>(threadcount) * lookups);
+}
+
+TEST_CASE("Registry concurrent lookup benchmark", "[.][benchmark][metrics_registry]")
+{
+    for (int threads : {1, 8, 64})
+    {
+        WARN(threads << " threads: default_repository " << concurrent_lookup_ns<default_repository>(threads, 20000)
+                     << "ns per lookup, read_mostly_repository " << concurrent_lookup_ns<read_mostly_repository>(threads, 20000)
+                     << "ns per lookup, sharded_repository " << concurrent_lookup_ns<sharded_repository<>>(threads, 20000) << "ns per lookup");
+    }
+}
+
+template<typename TRepository>
+static long long repository_lookup_ns(const std::vector<metric_path>& paths, const std::vector<std::size_t>& order)
+{
+    TRepository repo;
+    for (const auto& path : paths)
+        repo.get_or_add(path, []() { return std::make_unique<registered_metric<cxxmetrics::counter<int64_t>>>("counter"); });
+
+    std::size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto i : order)
+        found += repo.get(paths[i]) != nullptr;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(found == order.size());
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / static_cast<long long>(order.size());
+}
+
+TEST_CASE("Repository lookup benchmark", "[.][benchmark][metrics_registry]")
+{
+    for (std::size_t count : {10000, 100000, 1000000})
+    {
+        std::vector<metric_path> paths;
+        paths.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+            paths.push_back("service"_m/std::to_string(i % 100)/("metric" + std::to_string(i)));
+
+        std::mt19937 random(7);
+        std::vector<std::size_t> order(1000000);
+        for (auto& i : order)
+            i = random() % count;
+
+        WARN(count << " paths: default_repository " << repository_lookup_ns<default_repository>(paths, order)
+                   << "ns, read_mostly_repository " << repository_lookup_ns<read_mostly_repository>(paths, order)
+                   << "ns, sharded_repository " << repository_lookup_ns<sharded_repository<>>(paths, order) << "ns per lookup");
+    }
+}
+
+TEST_CASE("Registry bound metric refs find the registered metric", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    auto counter = subject.counter("MyCounter", {{"mytag", "tagvalue"}});
+    auto ref = subject.bind<cxxmetrics::counter<int64_t>>("MyCounter", {{"mytag", "tagvalue"}});
+
+    REQUIRE(ref.get() == counter);
+    REQUIRE(ref.key().tags() == tag_collection({{"mytag", "tagvalue"}}));
+    REQUIRE(ref.key().hash() == std::hash<tag_collection>()(tag_collection({{"mytag", "tagvalue"}})));
+
+    *counter += 5;
+    *ref.get() += 5;
+    REQUIRE(counter->value() == 10);
+
+    auto created = subject.bind<cxxmetrics::counter<int64_t>>("MyCounter", {{"mytag", "other"}}, 7);
+    REQUIRE(created->value() == 7);
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "other"}}) == created.get());
+
+    REQUIRE_THROWS_AS(subject.bind<cxxmetrics::counter<short>>("MyCounter", {{"mytag", "tagvalue"}}), metric_type_mismatch);
+}
+
+TEST_CASE("Registry bound lookup benchmark", "[.][benchmark][metrics_registry]")
+{
+    metrics_registry<> subject;
+    const tag_collection tags{{"service", "api"}, {"status", 200}, {"method", "GET"}};
+    auto ref = subject.bind<cxxmetrics::counter<int64_t>>("requests"_m/"served", tags);
+    constexpr int lookups = 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+        *subject.counter("requests"_m/"served", tags) += 1;
+    auto named = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+        *ref.get() += 1;
+    auto bound = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(ref->value() == lookups * 2);
+    WARN(lookups << " lookups by name took " << std::chrono::duration_cast<std::chrono::milliseconds>(named).count()
+                 << "ms, through a bound ref took " << std::chrono::duration_cast<std::chrono::milliseconds>(bound).count() << "ms");
+}
+
+TEST_CASE("Registry visitors don't hold locks while they run", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    *subject.counter("MyCounter") += 10;
+    *subject.counter("MyCounter", {{"mytag", "tagvalue"}}) += 45;
+
+    // registering from inside a visitor would deadlock if visiting held the repository or metric locks
+    int instances = 0;
+    int total = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.visit([&](const tag_collection& tags, const value_snapshot& ctr) {
+            ++instances;
+            total += static_cast<int>(ctr.value());
+            subject.counter("MyCounter", {{"visited", instances}});
+            subject.counter("AnotherCounter");
+        });
+    });
+
+    REQUIRE(instances == 2);
+    REQUIRE(total == 55);
+    REQUIRE(subject.counter("MyCounter", {{"visited", 2}})->value() == 0);
+}
+
+TEST_CASE("Registry sweeps idle permutations past their retention", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    *subject.counter("MyCounter", {{"mytag", "idle"}}) += 5;
+    auto held = subject.counter("MyCounter", {{"mytag", "held"}});
+    *held += 7;
+
+    subject.retention("MyCounter", 1s);
+    subject.counter("MyCounter", {{"mytag", "idle"}});
+    REQUIRE(subject.sweep() == 0);
+
+    // the held permutation is still in use even though it hasn't been looked up
+    REQUIRE(subject.sweep(coarse_clock::now() + 1h) == 1);
+
+    int instances = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.visit([&](const tag_collection& tags, const value_snapshot& ctr) {
+            ++instances;
+            REQUIRE(tags == tag_collection({{"mytag", "held"}}));
+            REQUIRE(ctr.value() == metric_value(7));
+        });
+    });
+    REQUIRE(instances == 1);
+
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "idle"}})->value() == 0);
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "held"}}) == held);
+}
+
+TEST_CASE("Registry only sweeps once lookups have had time to see the retention policy", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.counter("MyCounter", {{"mytag", "idle"}});
+    REQUIRE(subject.sweep(std::chrono::steady_clock::now() + 1h) == 0);
+
+    // lookups from before the policy was set might not have taken a read guard
+    subject.retention("MyCounter", 1ns);
+    subject.counter("MyCounter", {{"mytag", "idle"}});
+    REQUIRE(subject.sweep() == 0);
+    REQUIRE(subject.sweep(std::chrono::steady_clock::now() + 1h) == 1);
+}
+
+TEST_CASE("Registry sends permutations past the limit to the overflow tags", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.counter("MyCounter");
+    subject.retention("MyCounter", 0s, 3);
+
+    for (int i = 0; i < 10; i++)
+        *subject.counter("MyCounter", {{"user", i}}) += 1;
+
+    REQUIRE(subject.counter("MyCounter", {{"user", 1}})->value() == 1);
+    REQUIRE(subject.counter("MyCounter", {{"user", 5}}) == subject.counter("MyCounter", basic_registered_metric::overflow_tags()));
+
+    int instances = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.visit([&](const tag_collection& tags, const value_snapshot& ctr) {
+            ++instances;
+            if (tags == basic_registered_metric::overflow_tags())
+                REQUIRE(ctr.value() == metric_value(8));
+        });
+    });
+    REQUIRE(instances == 4);
+}
+
+TEST_CASE("Registry holds the permutation limit when threads add tags at once", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.counter("MyCounter");
+    subject.retention("MyCounter", 0s, 10);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+        threads.emplace_back([&subject, t]() {
+            for (int i = 0; i < 50; i++)
+                *subject.counter("MyCounter", {{"thread", t}, {"user", i}}) += 1;
+        });
+
+    for (auto& t : threads)
+        t.join();
+
+    int instances = 0;
+    metric_value total(0);
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.visit([&](const tag_collection& tags, const value_snapshot& ctr) {
+            ++instances;
+            total = total + ctr.value();
+        });
+    });
+
+    // the limit plus the overflow permutation, without losing any of the increments
+    REQUIRE(instances == 11);
+    REQUIRE(total == metric_value(400));
+}
+
+TEST_CASE("Registry bound refs outlive their permutation being swept", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    auto ref = subject.bind<cxxmetrics::counter<int64_t>>("MyCounter", {{"mytag", "tagvalue"}}, 3);
+    subject.retention("MyCounter", 1s);
+    *ref.get() += 1;
+
+    REQUIRE(subject.sweep(coarse_clock::now() + 1h) == 1);
+    REQUIRE(ref->value() == 3);
+    REQUIRE(ref.get() == subject.counter("MyCounter", {{"mytag", "tagvalue"}}));
+}
+
+TEST_CASE("Registry lookups race safely with sweeps", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.counter("MyCounter");
+    subject.retention("MyCounter", 1ms);
+    for (int i = 0; i < 32; i++)
+        subject.counter("MyCounter", {{"tag", i}});
+
+    std::atomic<bool> running(true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++)
+        threads.emplace_back([&subject, &running]() {
+            while (running.load())
+                for (int i = 0; i < 32; i++)
+                    *subject.counter("MyCounter", {{"tag", i}}) += 1;
+        });
+
+    std::size_t dropped = 0;
+    for (int i = 0; i < 200; i++)
+        dropped += subject.sweep(coarse_clock::now() + 1h);
+
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    REQUIRE(dropped > 0);
+}
+
+TEST_CASE("Registry lookups racing sweeps never get a dropped permutation", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.cache_lookups(GENERATE(false, true));
+    subject.counter("MyCounter");
+    subject.retention("MyCounter", 1ns);
+    for (int i = 0; i < 8; i++)
+        subject.counter("MyCounter", {{"tag", i}});
+
+    std::atomic<bool> running(true);
+    std::atomic<int> orphaned(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++)
+        threads.emplace_back([&subject, &running, &orphaned]() {
+            while (running.load())
+                for (int i = 0; i < 8; i++)
+                {
+                    // while the first lookup is held the permutation can't be dropped, so both have to be the same
+                    auto c = subject.counter("MyCounter", {{"tag", i}});
+                    if (subject.counter("MyCounter", {{"tag", i}}) != c)
+                        orphaned++;
+                }
+        });
+
+    std::size_t dropped = 0;
+    auto deadline = std::chrono::steady_clock::now() + 200ms;
+    while (std::chrono::steady_clock::now() < deadline)
+        dropped += subject.sweep(coarse_clock::now() + 1h);
+
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    REQUIRE(dropped > 0);
+    REQUIRE(orphaned == 0);
+}
+
+TEST_CASE("Registry lookup cache returns the registered metrics", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.cache_lookups(true);
+
+    auto counter = subject.counter("MyCounter", {{"mytag", "tagvalue"}});
+    *counter += 5;
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "tagvalue"}}) == counter);
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "other"}}) != counter);
+    REQUIRE_THROWS_AS(subject.counter<short>("MyCounter", {{"mytag", "tagvalue"}}), metric_type_mismatch);
+
+    // another registry never sees this registry's cached metrics
+    metrics_registry<> other;
+    other.cache_lookups(true);
+    REQUIRE(other.counter("MyCounter", {{"mytag", "tagvalue"}}) != counter);
+
+    std::shared_ptr<cxxmetrics::counter<int64_t>> fromthread;
+    std::thread([&]() { fromthread = subject.counter("MyCounter", {{"mytag", "tagvalue"}}); }).join();
+    REQUIRE(fromthread == counter);
+}
+
+TEST_CASE("Registry lookup cache doesn't hand out swept permutations", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.cache_lookups(true);
+    *subject.counter("MyCounter", {{"mytag", "tagvalue"}}) += 5;
+    subject.retention("MyCounter", 1s);
+    *subject.counter("MyCounter", {{"mytag", "tagvalue"}}) += 5;
+
+    REQUIRE(subject.sweep(coarse_clock::now() + 1h) == 1);
+    auto counter = subject.counter("MyCounter", {{"mytag", "tagvalue"}});
+    REQUIRE(counter->value() == 0);
+
+    int instances = 0;
+    subject.visit_registered_metrics([&](const metric_path& path, basic_registered_metric& metric) {
+        metric.visit([&](const tag_collection& tags, const value_snapshot& ctr) {
+            ++instances;
+        });
+    });
+    REQUIRE(instances == 1);
+    REQUIRE(subject.counter("MyCounter", {{"mytag", "tagvalue"}}) == counter);
+}
+
+TEST_CASE("Registry lookup cache benchmark", "[.][benchmark][metrics_registry]")
+{
+    metrics_registry<> subject;
+    const tag_collection tags{{"service", "api"}, {"status", 200}, {"method", "GET"}};
+    const metric_path path = "requests"_m/"served";
+    constexpr int lookups = 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+        *subject.counter(path, tags) += 1;
+    auto uncached = std::chrono::steady_clock::now() - start;
+
+    subject.cache_lookups(true);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+        *subject.counter(path, tags) += 1;
+    auto cached = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(subject.counter(path, tags)->value() == lookups * 2);
+    WARN(lookups << " lookups took " << std::chrono::duration_cast<std::chrono::milliseconds>(uncached).count()
+                 << "ms, through the lookup cache took " << std::chrono::duration_cast<std::chrono::milliseconds>(cached).count() << "ms");
+}
+
+template<typename TRepository>
+static void check_batch_registration()
+{
+    metrics_registry<TRepository> subject;
+    auto existing = subject.counter("counters"_m/"one", {{"tag", 1}});
+    *existing += 5;
+
+    std::vector<metric_registration<cxxmetrics::counter<int64_t>>> entries;
+    for (int path = 0; path < 10; path++)
+        for (int tag = 0; tag < 20; tag++)
+            entries.emplace_back("counters"_m/std::to_string(path), tag_collection{{"tag", tag}});
+    entries.emplace_back("counters"_m/"one", tag_collection{{"tag", 1}});
+    entries.emplace_back("counters"_m/"one", tag_collection{{"tag", 2}}, []() { return std::make_shared<cxxmetrics::counter<int64_t>>(7); });
+    entries.emplace_back("counters"_m/"one", tag_collection{{"tag", 2}});
+
+    auto metrics = subject.register_batch(entries);
+    REQUIRE(metrics.size() == entries.size());
+    REQUIRE(metrics[entries.size() - 3] == existing);
+    REQUIRE(metrics[entries.size() - 2]->value() == 7);
+    REQUIRE(metrics[entries.size() - 1] == metrics[entries.size() - 2]);
+    for (std::size_t i = 0; i < 200; i++)
+        REQUIRE(subject.template counter<int64_t>(entries[i].path, entries[i].tags) == metrics[i]);
+
+    int names = 0;
+    subject.visit_registered_metrics([&names](const metric_path&, basic_registered_metric&) { ++names; });
+    REQUIRE(names == 11);
+
+    std::vector<metric_registration<cxxmetrics::counter<short>>> mismatched{{"counters"_m/"one"}};
+    REQUIRE_THROWS_AS(subject.register_batch(mismatched), metric_type_mismatch);
+}
+
+namespace
+{
+
+struct needs_arguments
+{
+    explicit needs_arguments(int) { }
+};
+
+static_assert(std::is_constructible<metric_registration<cxxmetrics::counter<int64_t>>, metric_path>::value,
+        "default constructible metrics don't need a builder");
+static_assert(!std::is_constructible<metric_registration<needs_arguments>, metric_path>::value,
+        "metrics that can't be default constructed need a builder");
+static_assert(std::is_constructible<metric_registration<needs_arguments>, metric_path, tag_collection, metric_registration<needs_arguments>::metric_builder>::value,
+        "metrics that can't be default constructed can be registered with a builder");
+
+}
+
+TEST_CASE("Registry registers batches of metrics", "[metrics_registry]")
+{
+    check_batch_registration<default_repository>();
+    check_batch_registration<read_mostly_repository>();
+    check_batch_registration<sharded_repository<4>>();
+}
+
+TEST_CASE("Registry batch registration respects the permutation limit", "[metrics_registry]")
+{
+    metrics_registry<> subject;
+    subject.counter("MyCounter");
+    subject.retention("MyCounter", 0s, 3);
+
+    std::vector<metric_registration<cxxmetrics::counter<int64_t>>> entries;
+    for (int i = 0; i < 10; i++)
+        entries.emplace_back("MyCounter", tag_collection{{"user", i}});
+
+    auto metrics = subject.register_batch(entries);
+    REQUIRE(metrics[1] != metrics[0]);
+    REQUIRE(metrics[2] == metrics[9]);
+    REQUIRE(metrics[9] == subject.counter("MyCounter", basic_registered_metric::overflow_tags()));
+}
+
+template<typename TRepository>
+static std::pair<long long, long long> registration_ms(const std::vector<metric_registration<cxxmetrics::counter<int64_t>>>& entries)
+{
+    auto start = std::chrono::steady_clock::now();
+    {
+        metrics_registry<TRepository> subject;
+        for (const auto& entry : entries)
+            subject.template counter<int64_t>(entry.path, entry.tags);
+    }
+    auto single = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+        metrics_registry<TRepository> subject;
+        subject.register_batch(entries);
+    }
+    auto batched = std::chrono::steady_clock::now() - start;
+
+    return std::make_pair(std::chrono::duration_cast<std::chrono::milliseconds>(single).count(),
+                          std::chrono::duration_cast<std::chrono::milliseconds>(batched).count());
+}
+
+TEST_CASE("Registry batch registration benchmark", "[.][benchmark][metrics_registry]")
+{
+    // 50k metrics: 500 paths with 100 tag permutations each
+    std::vector<metric_registration<cxxmetrics::counter<int64_t>>> entries;
+    for (int path = 0; path < 500; path++)
+        for (int tag = 0; tag < 100; tag++)
+            entries.emplace_back("service"_m/("metric" + std::to_string(path)), tag_collection{{"status", tag}, {"method", "GET"}});
+
+    auto def = registration_ms<default_repository>(entries);
+    auto rm = registration_ms<read_mostly_repository>(entries);
+    auto sh = registration_ms<sharded_repository<>>(entries);
+    WARN("registering " << entries.size() << " metrics one at a time / batched: default_repository " << def.first << "ms / " << def.second
+         << "ms, read_mostly_repository " << rm.first << "ms / " << rm.second
+         << "ms, sharded_repository " << sh.first << "ms / " << sh.second << "ms");
+}
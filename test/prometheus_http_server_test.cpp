@@ -0,0 +1,280 @@
+#include <catch2/catch.hpp>
+#include <cxxmetrics_prometheus/prometheus_http_server.hpp>
+
+using namespace cxxmetrics;
+using namespace cxxmetrics_literals;
+using namespace cxxmetrics_prometheus;
+
+namespace
+{
+
+struct http_response
+{
+    std::string status;
+    std::string headers;
+    std::string body;
+};
+
+/**
+ * \brief A blocking http client that's just enough to scrape the server
+ */
+class http_client
+{
+    cxxmetrics_prometheus::internal::file_handle socket_;
+    std::string buffered_;
+
+    bool fill()
+    {
+        char buffer[4096];
+        auto received = ::recv(socket_.get(), buffer, sizeof(buffer), 0);
+        if (received <= 0)
+            return false;
+
+        buffered_.append(buffer, static_cast<std::size_t>(received));
+        return true;
+    }
+
+public:
+    explicit http_client(std::uint16_t port) :
+            socket_(::socket(AF_INET, SOCK_STREAM, 0))
+    {
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(::connect(socket_.get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+
+        timeval timeout{5, 0};
+        ::setsockopt(socket_.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    void send(const std::string& request)
+    {
+        REQUIRE(::send(socket_.get(), request.data(), request.size(), cxxmetrics_prometheus::internal::send_flags) == static_cast<ssize_t>(request.size()));
+    }
+
+    http_response receive(bool head = false)
+    {
+        std::size_t end;
+        while ((end = buffered_.find("\r\n\r\n")) == std::string::npos)
+            REQUIRE(fill());
+
+        http_response response;
+        auto status_end = buffered_.find("\r\n");
+        response.status = buffered_.substr(0, status_end);
+        response.headers = buffered_.substr(status_end + 2, end - status_end);
+        buffered_.erase(0, end + 4);
+
+        auto length = response.headers.find("Content-Length: ");
+        REQUIRE(length != std::string::npos);
+        auto size = head ? 0 : std::stoul(response.headers.substr(length + 16));
+        while (buffered_.size() < size)
+            REQUIRE(fill());
+
+        response.body = buffered_.substr(0, size);
+        buffered_.erase(0, size);
+        return response;
+    }
+
+    http_response get(const std::string& path, const std::string& headers = "")
+    {
+        send("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n");
+        return receive();
+    }
+
+    bool closed_by_server()
+    {
+        return buffered_.empty() && !fill();
+    }
+};
+
+http_server_options local_options()
+{
+    http_server_options options;
+    options.port = 0;
+    return options;
+}
+
+}
+
+TEST_CASE("Prometheus http server serves metrics over keep-alive connections", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    *r.counter("MyCounter", {{"mytag", "value"}}) += 42;
+
+    prometheus_http_server<decltype(r)::repository_type> subject(r, local_options());
+    subject.start();
+    REQUIRE(subject.port() != 0);
+
+    http_client client(subject.port());
+    auto first = client.get("/metrics");
+    REQUIRE(first.status == "HTTP/1.1 200 OK");
+    REQUIRE_THAT(first.headers, Catch::Contains("Content-Type: text/plain; version=0.0.4") && Catch::Contains("Connection: keep-alive"));
+    REQUIRE_THAT(first.body, Catch::Contains("MyCounter{mytag=\"value\"} 42"));
+
+    *r.counter("MyCounter", {{"mytag", "value"}}) += 1;
+    auto second = client.get("/metrics?name=ignored");
+    REQUIRE(second.status == "HTTP/1.1 200 OK");
+    REQUIRE_THAT(second.body, Catch::Contains("MyCounter{mytag=\"value\"} 43"));
+
+    // pipelined requests are answered in order
+    client.send("HEAD /metrics HTTP/1.1\r\n\r\nGET /metrics HTTP/1.1\r\n\r\n");
+    auto head = client.receive(true);
+    auto get = client.receive();
+    REQUIRE(head.status == "HTTP/1.1 200 OK");
+    REQUIRE(get.body == second.body);
+    REQUIRE_THAT(head.headers, Catch::Contains("Content-Length: " + std::to_string(get.body.size())));
+
+    subject.stop();
+    REQUIRE(client.closed_by_server());
+}
+
+TEST_CASE("Prometheus http server rejects other requests", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    prometheus_http_server<decltype(r)::repository_type> subject(r, local_options());
+    subject.start();
+
+    SECTION("Other paths aren't found")
+    {
+        http_client client(subject.port());
+        REQUIRE(client.get("/other").status == "HTTP/1.1 404 Not Found");
+        REQUIRE(client.closed_by_server());
+    }
+
+    SECTION("Other methods aren't allowed")
+    {
+        http_client client(subject.port());
+        client.send("POST /metrics HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+        REQUIRE(client.receive().status == "HTTP/1.1 405 Method Not Allowed");
+        REQUIRE(client.closed_by_server());
+    }
+
+    SECTION("Malformed requests are bad")
+    {
+        http_client client(subject.port());
+        client.send("nonsense\r\n\r\n");
+        REQUIRE(client.receive().status == "HTTP/1.1 400 Bad Request");
+        REQUIRE(client.closed_by_server());
+    }
+
+    SECTION("Requests bigger than a scraper's are too large")
+    {
+        http_client client(subject.port());
+        client.send("GET /metrics HTTP/1.1\r\nX-Padding: " + std::string(20000, 'x'));
+        REQUIRE(client.receive().status == "HTTP/1.1 431 Request Header Fields Too Large");
+        REQUIRE(client.closed_by_server());
+    }
+}
+
+TEST_CASE("Prometheus http server closes connections when asked", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    *r.counter("MyCounter") += 1;
+    prometheus_http_server<decltype(r)::repository_type> subject(r, local_options());
+    subject.start();
+
+    SECTION("With a connection header")
+    {
+        http_client client(subject.port());
+        auto response = client.get("/metrics", "Connection: close\r\n");
+        REQUIRE(response.status == "HTTP/1.1 200 OK");
+        REQUIRE_THAT(response.headers, Catch::Contains("Connection: close"));
+        REQUIRE(client.closed_by_server());
+    }
+
+    SECTION("With HTTP/1.0")
+    {
+        http_client client(subject.port());
+        client.send("GET /metrics HTTP/1.0\r\n\r\n");
+        REQUIRE_THAT(client.receive().body, Catch::Contains("MyCounter{} 1"));
+        REQUIRE(client.closed_by_server());
+    }
+}
+
+TEST_CASE("Prometheus http server coalesces scrapes", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    auto counter = r.counter("MyCounter");
+    *counter += 1;
+
+    SECTION("Scrapes within the window share a render")
+    {
+        auto options = local_options();
+        options.coalesce_window = std::chrono::hours(1);
+        prometheus_http_server<decltype(r)::repository_type> subject(r, options);
+        subject.start();
+
+        http_client first(subject.port());
+        http_client second(subject.port());
+        auto a = first.get("/metrics");
+        *counter += 1;
+        auto b = second.get("/metrics");
+
+        REQUIRE_THAT(a.body, Catch::Contains("MyCounter{} 1"));
+        REQUIRE(a.body == b.body);
+        REQUIRE(subject.renders() == 1);
+    }
+
+    SECTION("Waiting scrapes share a render")
+    {
+        prometheus_http_server<decltype(r)::repository_type> subject(r, local_options());
+        subject.start();
+
+        http_client client(subject.port());
+        client.send("GET /metrics HTTP/1.1\r\n\r\nGET /metrics HTTP/1.1\r\n\r\n");
+        auto a = client.receive();
+        auto b = client.receive();
+        REQUIRE(a.body == b.body);
+        REQUIRE(subject.renders() == 1);
+
+        *counter += 1;
+        REQUIRE_THAT(client.get("/metrics").body, Catch::Contains("MyCounter{} 2"));
+        REQUIRE(subject.renders() == 2);
+    }
+}
+
+#ifdef CXXMETRICS_PROMETHEUS_ZLIB
+TEST_CASE("Prometheus http server gzips responses for scrapers that accept it", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    for (int i = 0; i < 100; i++)
+        *r.counter("MyCounter", {{"index", i}}) += i;
+
+    auto options = local_options();
+    options.gzip = true;
+    prometheus_http_server<decltype(r)::repository_type> subject(r, options);
+    subject.start();
+
+    http_client client(subject.port());
+    auto plain = client.get("/metrics");
+    auto gzipped = client.get("/metrics", "Accept-Encoding: deflate, gzip;q=1.0\r\n");
+    REQUIRE_THAT(plain.headers, !Catch::Contains("Content-Encoding"));
+    REQUIRE_THAT(gzipped.headers, Catch::Contains("Content-Encoding: gzip"));
+    REQUIRE(gzipped.body.size() < plain.body.size());
+
+    std::string inflated(plain.body.size() * 2, '\0');
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    REQUIRE(inflateInit2(&stream, 15 + 16) == Z_OK);
+    stream.next_in = reinterpret_cast<Bytef*>(&gzipped.body[0]);
+    stream.avail_in = static_cast<uInt>(gzipped.body.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&inflated[0]);
+    stream.avail_out = static_cast<uInt>(inflated.size());
+    REQUIRE(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+    inflated.resize(stream.total_out);
+    inflateEnd(&stream);
+
+    REQUIRE(inflated == plain.body);
+}
+#else
+TEST_CASE("Prometheus http server needs zlib to gzip", "[prometheus][http]")
+{
+    metrics_registry<> r;
+    auto options = local_options();
+    options.gzip = true;
+
+    REQUIRE_THROWS_AS((prometheus_http_server<decltype(r)::repository_type>(r, options)), std::invalid_argument);
+}
+#endif
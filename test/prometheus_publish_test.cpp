@@ -1,4 +1,6 @@
 #include <catch2/catch.hpp>
+#include <cmath>
+#include <limits>
 #include <sstream>
 #include <cxxmetrics_prometheus/prometheus_publisher.hpp>
 #include <cxxmetrics/simple_reservoir.hpp>
@@ -122,3 +124,158 @@ TEST_CASE("Prometheus Publisher can publish timer values", "[prometheus]")
             Catch::Contains("5min") &&
             Catch::Contains("x2=\"123523\""));
 }
+
+TEST_CASE("Prometheus text writer formats numbers", "[prometheus]")
+{
+    std::string out;
+    cxxmetrics_prometheus::internal::text_writer writer(out);
+
+    writer << 0 << ' ' << -1 << ' ' << 1234567890123ll << ' ' << std::numeric_limits<long long>::min() << ' '
+           << std::numeric_limits<unsigned long long>::max();
+    REQUIRE(out == "0 -1 1234567890123 -9223372036854775808 18446744073709551615");
+
+    out.clear();
+    writer << 923.005 << ' ' << 5.0 << ' ' << -0.25 << ' ' << 0.0000001 << ' ' << 1.9999999;
+    REQUIRE(out == "923.005 5 -0.25 0 2");
+
+    out.clear();
+    writer << std::nan("") << ' ' << std::numeric_limits<double>::infinity() << ' ' << -std::numeric_limits<double>::infinity();
+    REQUIRE(out == "NaN +Inf -Inf");
+
+    out.clear();
+    writer << metric_value(42) << ' ' << metric_value(1.5) << ' ' << metric_value("text");
+    REQUIRE(out == "42 1.5 text");
+}
+
+TEST_CASE("Prometheus Publisher escapes label values", "[prometheus]")
+{
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    *r.counter("MyCounter", {{"path", "C:\\dir\nnext"}}) += 1;
+
+    std::string out;
+    subject.write(out);
+
+    REQUIRE_THAT(out, Catch::Contains("MyCounter{path=\"C:\\\\dir\\nnext\"} 1"));
+}
+
+TEST_CASE("Prometheus Publisher writes the same text on every scrape", "[prometheus]")
+{
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    for (int i = 0; i < 10; i++)
+        *r.counter("MyCounter", {{"index", i}, {"name", "value"}}) += i;
+    r.gauge("MyGauge"/"value"_m, 12.5, {{"tag_name", "tag_value"}});
+
+    std::string first;
+    subject.write(first);
+
+    std::string second;
+    subject.write(second);
+
+    std::stringstream stream;
+    subject.write(stream);
+
+    REQUIRE_THAT(first, Catch::Contains("MyCounter{index=\"9\",name=\"value\"} 9"));
+    REQUIRE(first == second);
+    REQUIRE(first == stream.str());
+}
+
+TEST_CASE("Prometheus Publisher stops writing permutations the registry dropped", "[prometheus]")
+{
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    *r.counter("MyCounter", {{"mytag", "idle"}}) += 5;
+    auto held = r.counter("MyCounter", {{"mytag", "held"}});
+    *held += 7;
+
+    std::string out;
+    subject.write(out);
+    REQUIRE_THAT(out, Catch::Contains("mytag=\"idle\"") && Catch::Contains("mytag=\"held\""));
+
+    r.retention("MyCounter", std::chrono::seconds(1));
+    r.counter("MyCounter", {{"mytag", "idle"}});
+    REQUIRE(r.sweep(coarse_clock::now() + std::chrono::hours(1)) == 1);
+
+    out.clear();
+    subject.write(out);
+    REQUIRE_THAT(out, !Catch::Contains("mytag=\"idle\"") && Catch::Contains("mytag=\"held\"} 7"));
+}
+
+TEST_CASE("Prometheus Publisher writes snapshot sets the same as the registry", "[prometheus]")
+{
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    for (int i = 0; i < 10; i++)
+        *r.counter("MyCounter", {{"index", i}}) += i;
+    r.gauge("MyGauge"/"value"_m, 12.5, {{"tag_name", "tag_value"}});
+    auto& h = *r.histogram("MyHistogram", simple_reservoir<int64_t, 100>());
+    for (int i = 1; i <= 100; i++)
+        h.update(i);
+
+    snapshot_set snapshots(r);
+    std::string from_snapshots;
+    subject.write(from_snapshots, snapshots);
+
+    std::string direct;
+    subject.write(direct);
+
+    REQUIRE_THAT(from_snapshots, Catch::Contains("MyCounter{index=\"9\"} 9"));
+    REQUIRE(from_snapshots == direct);
+}
+
+TEST_CASE("Prometheus Publisher writes on several threads in order", "[prometheus]")
+{
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    for (int i = 0; i < 100; i++)
+    {
+        *r.counter("MyCounter"_m/std::to_string(i), {{"index", i}}) += i;
+        r.histogram("MyHistogram"_m/std::to_string(i), simple_reservoir<int64_t, 100>())->update(i);
+    }
+
+    worker_pool workers(4);
+    snapshot_set snapshots(r, workers);
+
+    std::string serial;
+    subject.write(serial, snapshots);
+
+    std::string parallel = "# prefix\n";
+    subject.write(parallel, snapshots, workers);
+
+    REQUIRE(parallel == "# prefix\n" + serial);
+}
+
+TEST_CASE("Prometheus Publisher write benchmark", "[.][benchmark][prometheus]")
+{
+    // 200k series: 2000 counters with 100 tag permutations each
+    metrics_registry<> r;
+    prometheus_publisher<decltype(r)::repository_type> subject(r);
+    for (int path = 0; path < 2000; path++)
+        for (int tag = 0; tag < 100; tag++)
+            *r.counter("service"_m/("requests" + std::to_string(path)), {{"status", tag}, {"method", "GET"}}) += path * tag;
+
+    std::stringstream stream;
+    subject.write(stream);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; i++)
+    {
+        std::stringstream out;
+        subject.write(out);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    WARN("writing 200k series took " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 5 << "ms per scrape");
+
+    std::string buffer;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; i++)
+    {
+        buffer.clear();
+        subject.write(buffer);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+
+    WARN("writing 200k series into a reused string took " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 5 << "ms per scrape");
+}
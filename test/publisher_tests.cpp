@@ -1,4 +1,5 @@
 #include <catch2/catch.hpp>
+#include <algorithm>
 #include <thread>
 #include <cxxmetrics/metrics_registry.hpp>
 #include <cxxmetrics/simple_reservoir.hpp>
@@ -61,6 +62,12 @@ public:
         return this->visit_all(std::forward<THandler>(handler));
     }
 
+    template<typename THandler>
+    std::uint64_t visit_registry_changes(std::uint64_t since, THandler&& handler) const
+    {
+        return this->visit_changed(since, std::forward<THandler>(handler));
+    }
+
     const auto& opts(basic_registered_metric& metric)
     {
         return this->effective_options(metric);
@@ -201,6 +208,66 @@ TEST_CASE("Publisher visit_all sanity check", "[publisher]")
     REQUIRE(count == 3);
 }
 
+TEST_CASE("Publisher visit_changed only visits what changed since the last visit", "[publisher]")
+{
+    metrics_registry<> r;
+    test_publisher<> subject(r);
+    auto a = r.counter("MyCounter", {{"tag", "a"}});
+    auto b = r.counter("MyCounter", {{"tag", "b"}});
+    auto meter = r.meter<1_sec, 1_min>("Meter");
+    auto h = r.histogram("Histogram", simple_reservoir<int64_t, 10>());
+    auto g = r.gauge<int64_t>("Gauge", 5);
+    int provided = 3;
+    r.gauge("Provided", provided);
+
+    std::vector<std::string> visited;
+    auto collect = [&visited](std::uint64_t since) {
+        return [&visited, since](const metric_path& path, basic_registered_metric& metric) {
+            metric.visit_changed(since, [&](const tag_collection& tags, const auto&) {
+                auto name = path.join("/");
+                for (const auto& tag : tags)
+                    name += "/" + static_cast<std::string>(tag.second);
+                visited.push_back(name);
+            });
+        };
+    };
+
+    // a generation of 0 visits everything
+    auto since = subject.visit_registry_changes(0, collect(0));
+    std::sort(visited.begin(), visited.end());
+    REQUIRE(visited == std::vector<std::string>({"Gauge", "Histogram", "Meter", "MyCounter/a", "MyCounter/b", "Provided"}));
+
+    // anything stamped with the generation that was ending is visited again in case it raced the last visit
+    visited.clear();
+    since = subject.visit_registry_changes(since, collect(since));
+    REQUIRE(visited.size() == 6);
+
+    // only the gauge over a reference, which can't tell when it changes
+    visited.clear();
+    since = subject.visit_registry_changes(since, collect(since));
+    REQUIRE(visited == std::vector<std::string>({"Provided"}));
+
+    *b += 1;
+    meter->mark(2);
+    h->update(7);
+    g->set(6);
+    visited.clear();
+    since = subject.visit_registry_changes(since, collect(since));
+    std::sort(visited.begin(), visited.end());
+    REQUIRE(visited == std::vector<std::string>({"Gauge", "Histogram", "Meter", "MyCounter/b", "Provided"}));
+
+    *a += 1;
+    visited.clear();
+    since = subject.visit_registry_changes(since, collect(since));
+    std::sort(visited.begin(), visited.end());
+    REQUIRE(visited == std::vector<std::string>({"Gauge", "Histogram", "Meter", "MyCounter/a", "MyCounter/b", "Provided"}));
+
+    visited.clear();
+    subject.visit_registry_changes(since, collect(since));
+    std::sort(visited.begin(), visited.end());
+    REQUIRE(visited == std::vector<std::string>({"MyCounter/a", "Provided"}));
+}
+
 TEST_CASE("Publisher can get value publish options", "[publisher]")
 {
     metrics_registry<> r;
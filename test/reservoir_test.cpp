@@ -1,7 +1,14 @@
 #include <catch2/catch.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include <cxxmetrics/simple_reservoir.hpp>
 #include <cxxmetrics/uniform_reservoir.hpp>
+#include <cxxmetrics/concurrent_uniform_reservoir.hpp>
 #include <cxxmetrics/sliding_window.hpp>
+#include <cxxmetrics/hdr_reservoir.hpp>
+#include <cxxmetrics/exponential_decay.hpp>
+#include <cxxmetrics/histogram.hpp>
 #include "helpers.hpp"
 
 using namespace std;
@@ -145,3 +152,289 @@ TEST_CASE("Sliding Window Reservoir only gets window data", "[reservoir]")
 
     sliding_window_reservoir<double, 10, mock_clock> q = r;
 }
+
+TEST_CASE("Typed reservoir snapshots keep the element type", "[reservoir]")
+{
+    simple_reservoir<int64_t, 5> r;
+    r.update(30);
+    r.update(10);
+    r.update(20);
+
+    basic_reservoir_snapshot<int64_t> s = r.snapshot();
+    REQUIRE(s.values() == std::vector<int64_t>({10, 20, 30}));
+    REQUIRE(s.min() == metric_value(10));
+    REQUIRE(s.max() == metric_value(30));
+    REQUIRE(s.mean() == metric_value(20));
+    REQUIRE(std::abs(static_cast<double>(s.value<50_p>()) - 20.0) < 0.01);
+
+    reservoir_snapshot erased(std::move(s));
+    REQUIRE(erased.size() == 3);
+    REQUIRE(std::abs(static_cast<double>(erased.value<50_p>()) - 20.0) < 0.01);
+}
+
+TEST_CASE("Selected snapshot quantiles match sorted quantiles", "[reservoir]")
+{
+    std::vector<int64_t> data(1000);
+    default_random_engine engine(42);
+    uniform_int_distribution<int64_t> d(0, 100000);
+    for (auto& v : data)
+        v = d(engine);
+
+    basic_reservoir_snapshot<int64_t> sorted(data.data(), data.size());
+    basic_reservoir_snapshot<int64_t> selected(data.data(), data.size());
+
+    const long double quantiles[] = { 0.5, 0.9, 0.99 };
+    selected.select(quantiles, 3);
+
+    REQUIRE(selected.value<50_p>() == sorted.value<50_p>());
+    REQUIRE(selected.value<90_p>() == sorted.value<90_p>());
+    REQUIRE(selected.value<99_p>() == sorted.value<99_p>());
+    REQUIRE(selected.min() == metric_value(*std::min_element(data.begin(), data.end())));
+    REQUIRE(selected.max() == metric_value(*std::max_element(data.begin(), data.end())));
+
+    // a quantile that wasn't selected falls back to sorting
+    REQUIRE(selected.value<75_p>() == sorted.value<75_p>());
+    REQUIRE(std::is_sorted(selected.values().begin(), selected.values().end()));
+}
+
+TEST_CASE("Snapshot quantile selection benchmark", "[.][benchmark][reservoir]")
+{
+    default_random_engine engine(42);
+    uniform_int_distribution<int64_t> d(0, 1000000);
+    const long double quantiles[] = { 0.5, 0.9, 0.99 };
+
+    for (std::size_t size = 1024; size <= 65536; size *= 4)
+    {
+        std::vector<int64_t> data(size);
+        for (auto& v : data)
+            v = d(engine);
+
+        auto start = std::chrono::steady_clock::now();
+        basic_reservoir_snapshot<int64_t> sorted(data.data(), data.size());
+        auto sum = sorted.value<50_p>() + sorted.value<90_p>() + sorted.value<99_p>() + sorted.min() + sorted.max();
+        auto sort_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        basic_reservoir_snapshot<int64_t> selected(data.data(), data.size());
+        selected.select(quantiles, 3);
+        auto ssum = selected.value<50_p>() + selected.value<90_p>() + selected.value<99_p>() + selected.min() + selected.max();
+        auto select_time = std::chrono::steady_clock::now() - start;
+
+        REQUIRE(sum == ssum);
+        WARN(size << " values: sort " << std::chrono::duration_cast<std::chrono::microseconds>(sort_time).count()
+                  << "us, select " << std::chrono::duration_cast<std::chrono::microseconds>(select_time).count() << "us");
+    }
+}
+
+TEST_CASE("HDR reservoir keeps values to the requested precision", "[reservoir]")
+{
+    hdr_reservoir<int64_t, 1, 10000000, 3> r;
+    for (int64_t i = 1; i <= 1000000; i++)
+        r.update(i);
+
+    auto s = r.snapshot();
+    REQUIRE(s.size() == 1000000);
+    REQUIRE(s.min() == metric_value(1));
+    REQUIRE(std::abs(static_cast<double>(s.max()) - 1000000.0) / 1000000.0 < 0.001);
+    REQUIRE(std::abs(static_cast<double>(s.mean()) - 500000.5) / 500000.5 < 0.001);
+    REQUIRE(std::abs(static_cast<double>(s.value<50_p>()) - 500000.0) / 500000.0 < 0.001);
+    REQUIRE(std::abs(static_cast<double>(s.value<99.9_p>()) - 999000.0) / 999000.0 < 0.001);
+    REQUIRE(std::abs(static_cast<double>(s.value<99.99_p>()) - 999900.0) / 999900.0 < 0.001);
+
+    // small values are exact
+    hdr_reservoir<int64_t, 1, 10000000, 3> small;
+    small.update(10);
+    small.update(20);
+    small.update(30);
+    auto ss = small.snapshot();
+    REQUIRE(ss.min() == metric_value(10));
+    REQUIRE(ss.max() == metric_value(30));
+    REQUIRE(ss.mean() == metric_value(20));
+}
+
+TEST_CASE("HDR reservoir clamps and merges", "[reservoir]")
+{
+    hdr_reservoir<std::chrono::microseconds, 1, 1000000, 2> a;
+    hdr_reservoir<std::chrono::microseconds, 1, 1000000, 2> b;
+
+    a.update(std::chrono::microseconds(-5));
+    a.update(std::chrono::microseconds(50));
+    b.update(std::chrono::microseconds(5000000));
+
+    auto s = a.snapshot();
+    s.merge(b.snapshot());
+
+    REQUIRE(s.size() == 3);
+    REQUIRE(s.min() == metric_value(std::chrono::microseconds(0)));
+    REQUIRE(std::abs(static_cast<double>(s.max()) - 1000000.0) / 1000000.0 < 0.01);
+
+    histogram<std::chrono::microseconds, hdr_reservoir<std::chrono::microseconds, 1, 1000000, 2>> h;
+    h.update(std::chrono::microseconds(100));
+    auto hs = h.snapshot();
+    REQUIRE(hs.count() == 1);
+    REQUIRE(hs.max() == metric_value(std::chrono::microseconds(100)));
+}
+
+TEST_CASE("HDR reservoir is still usable after being moved from", "[reservoir]")
+{
+    hdr_reservoir<int64_t, 1, 1000000, 2> source;
+    source.update(10);
+
+    hdr_reservoir<int64_t, 1, 1000000, 2> moved(std::move(source));
+    source.update(20);
+    REQUIRE(moved.snapshot().size() == 1);
+    REQUIRE(source.snapshot().size() == 2);
+}
+
+TEST_CASE("Exponential decay reservoir favors recent values", "[reservoir]")
+{
+    unsigned time = 0;
+    mock_clock clk(time);
+    exponential_decay_reservoir<int, 100, time::minutes(1), mock_clock> r(0.015, clk);
+
+    for (int i = 0; i < 1000; i++)
+        r.update(1);
+
+    auto s = r.snapshot();
+    REQUIRE(s.size() == 100);
+    REQUIRE(s.max() == metric_value(1));
+
+    // ten minutes later crosses several rescales and the new values are about e^9 times heavier
+    for (int i = 0; i < 10; i++)
+    {
+        time += 60000000;
+        r.update(5);
+    }
+    for (int i = 0; i < 1000; i++)
+        r.update(10);
+
+    s = r.snapshot();
+    REQUIRE(s.size() == 100);
+    REQUIRE(s.min() >= metric_value(5));
+    REQUIRE(s.max() == metric_value(10));
+
+    exponential_decay_reservoir<int, 100, time::minutes(1), mock_clock> q = r;
+    REQUIRE(q.snapshot().max() == metric_value(10));
+}
+
+TEST_CASE("Exponential decay reservoir threaded updates", "[reservoir]")
+{
+    exponential_decay_reservoir<int64_t, 128> r;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&r, t]() {
+            for (int i = 0; i < 10000; i++)
+                r.update(t * 10000 + i);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    auto s = r.snapshot();
+    REQUIRE(s.size() == 128);
+    REQUIRE(s.min() >= metric_value(0));
+    REQUIRE(s.max() < metric_value(40000));
+}
+
+TEST_CASE("Concurrent uniform reservoir on exact count", "[reservoir]")
+{
+    concurrent_uniform_reservoir<double, 5> r;
+
+    r.update(10.0);
+    r.update(15.0);
+    r.update(30.0);
+    r.update(40.0);
+    r.update(45.0);
+
+    auto s = r.snapshot();
+
+    REQUIRE(s.size() == 5);
+    REQUIRE_THAT(s.min(), Catch::WithinULP(10.0, 1));
+    REQUIRE_THAT(s.max(), Catch::WithinULP(45.0, 1));
+    REQUIRE_THAT(s.mean(), Catch::WithinULP(28.0, 1));
+
+    concurrent_uniform_reservoir<double, 5> q = r;
+    REQUIRE(q.snapshot().size() == 5);
+}
+
+TEST_CASE("Concurrent uniform reservoir samples uniformly across threads", "[reservoir]")
+{
+    concurrent_uniform_reservoir<int, 1000, 4> r;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&r]() {
+            for (int i = 0; i < 100000; i++)
+                r.update(i % 1000);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    auto s = r.snapshot();
+    REQUIRE(s.size() <= 1000);
+    REQUIRE(s.size() >= 990);
+    REQUIRE(std::abs(static_cast<double>(s.mean()) - 499.5) < 50);
+    REQUIRE(std::abs(static_cast<double>(s.value<50_p>()) - 499.5) < 75);
+}
+
+TEST_CASE("Concurrent uniform reservoirs can be assigned to each other at once", "[reservoir]")
+{
+    concurrent_uniform_reservoir<int, 10, 4> a;
+    concurrent_uniform_reservoir<int, 10, 4> b;
+    for (int i = 0; i < 100; i++)
+    {
+        a.update(i);
+        b.update(-i);
+    }
+
+    std::thread forward([&a, &b]() {
+        for (int i = 0; i < 10000; i++)
+            a = b;
+    });
+    std::thread backward([&a, &b]() {
+        for (int i = 0; i < 10000; i++)
+            b = a;
+    });
+    forward.join();
+    backward.join();
+
+    REQUIRE(a.snapshot().size() == 10);
+    REQUIRE(b.snapshot().size() == 10);
+}
+
+namespace
+{
+
+template<typename TReservoir>
+double reservoir_updates_per_second(TReservoir& r, int threads, int updates)
+{
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&r, updates]() {
+            for (int i = 0; i < updates; i++)
+                r.update(i);
+        });
+    for (auto& w : workers)
+        w.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (threads * static_cast<double>(updates)) / elapsed.count();
+}
+
+}
+
+TEST_CASE("Uniform reservoir multithreaded throughput benchmark", "[.][benchmark][reservoir]")
+{
+    for (int threads : {1, 8, 32, 64})
+    {
+        auto uniform = std::make_unique<uniform_reservoir<int64_t, 1024>>();
+        auto concurrent = std::make_unique<concurrent_uniform_reservoir<int64_t, 1024>>();
+
+        auto u = reservoir_updates_per_second(*uniform, threads, 200000);
+        auto c = reservoir_updates_per_second(*concurrent, threads, 200000);
+
+        WARN(threads << " threads: uniform_reservoir " << static_cast<int64_t>(u) << " updates/sec, concurrent_uniform_reservoir "
+                     << static_cast<int64_t>(c) << " updates/sec");
+    }
+}
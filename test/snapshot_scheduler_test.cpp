@@ -0,0 +1,214 @@
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <cxxmetrics/snapshot_scheduler.hpp>
+#include <cxxmetrics/simple_reservoir.hpp>
+
+using namespace cxxmetrics;
+using namespace cxxmetrics_literals;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+template<typename TValue>
+TValue counter_value(const snapshot_set& snapshots, const tag_collection& tags)
+{
+    TValue result = 0;
+    for (const auto& metric : snapshots)
+        metric.visit([&](const tag_collection& t, const cumulative_value_snapshot& ss) {
+            if (t == tags)
+                result = ss.value();
+        });
+
+    return result;
+}
+
+struct failing_reservoir
+{
+    using value_type = int64_t;
+    static std::atomic<bool> fail;
+
+    void update(int64_t) noexcept
+    { }
+
+    basic_reservoir_snapshot<int64_t> snapshot() const
+    {
+        if (fail)
+            throw std::runtime_error("failed");
+        return simple_reservoir<int64_t, 10>().snapshot();
+    }
+};
+
+std::atomic<bool> failing_reservoir::fail(false);
+
+}
+
+TEST_CASE("Snapshot set keeps the values from when it was taken", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    auto c1 = r.counter("MyCounter", {{"mytag", 1}});
+    auto c2 = r.counter("MyCounter", {{"mytag", 2}});
+    r.gauge("MyGauge", 12.5);
+    *c1 += 10;
+    *c2 += 20;
+
+    snapshot_set subject(r);
+    *c1 += 100;
+    *c2 += 100;
+
+    REQUIRE(subject.size() == 2);
+    REQUIRE(counter_value<int64_t>(subject, {{"mytag", 1}}) == 10);
+    REQUIRE(counter_value<int64_t>(subject, {{"mytag", 2}}) == 20);
+
+    std::size_t series = 0;
+    for (const auto& metric : subject)
+    {
+        series += metric.size();
+        r.visit_registered_metrics([&metric](const metric_path& path, basic_registered_metric& registered) {
+            if (path == metric.path())
+                REQUIRE(&registered == &metric.registered());
+        });
+    }
+    REQUIRE(series == 3);
+}
+
+TEST_CASE("Snapshot set histograms can be read from several threads", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    auto& h = *r.histogram("MyHistogram", simple_reservoir<int64_t, 100>());
+    for (int i = 100; i > 0; i--)
+        h.update(i);
+
+    auto p50 = h.snapshot().value<50_p>();
+    snapshot_set subject(r);
+    h.update(1000);
+
+    std::vector<std::thread> readers;
+    std::atomic<int> matched(0);
+    for (int i = 0; i < 4; i++)
+        readers.emplace_back([&subject, &matched, p50]() {
+            for (const auto& metric : subject)
+                metric.visit([&matched, p50](const tag_collection&, const histogram_snapshot& ss) {
+                    if (ss.value<50_p>() == p50 && ss.max() == metric_value(100))
+                        matched++;
+                });
+        });
+
+    for (auto& t : readers)
+        t.join();
+    REQUIRE(matched == 4);
+}
+
+TEST_CASE("Snapshot scheduler publishes the latest snapshots", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    auto counter = r.counter("MyCounter");
+    *counter += 1;
+
+    snapshot_scheduler<decltype(r)::repository_type> subject(r, 10ms);
+    REQUIRE(subject.latest() == nullptr);
+
+    subject.start();
+    auto first = subject.latest();
+    REQUIRE(first != nullptr);
+    REQUIRE(counter_value<int64_t>(*first, {}) == 1);
+
+    SECTION("On the scheduler's thread")
+    {
+        *counter += 1;
+
+        // a snapshot might have been taken between the first one and the update
+        auto deadline = std::chrono::steady_clock::now() + 2s;
+        while (counter_value<int64_t>(*subject.latest(), {}) != 2 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(1ms);
+
+        auto latest = subject.latest();
+        REQUIRE(latest != first);
+        REQUIRE(latest->taken_at() > first->taken_at());
+        REQUIRE(counter_value<int64_t>(*latest, {}) == 2);
+    }
+
+    SECTION("When asked")
+    {
+        subject.stop();
+        *counter += 5;
+
+        auto now = subject.snapshot_now();
+        REQUIRE(subject.latest() == now);
+        REQUIRE(counter_value<int64_t>(*now, {}) == 6);
+        REQUIRE(counter_value<int64_t>(*first, {}) == 1);
+    }
+}
+
+TEST_CASE("Snapshot scheduler isn't started when the first snapshot fails", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    r.histogram("Failing", failing_reservoir());
+
+    snapshot_scheduler<decltype(r)::repository_type> subject(r, 10ms);
+    failing_reservoir::fail = true;
+    REQUIRE_THROWS_AS(subject.start(), std::runtime_error);
+    REQUIRE(subject.latest() == nullptr);
+
+    failing_reservoir::fail = false;
+    subject.start();
+    REQUIRE(subject.latest() != nullptr);
+}
+
+TEST_CASE("Snapshot set taken on several threads matches one taken on one", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    for (int i = 0; i < 50; i++)
+    {
+        *r.counter("Counter"_m/std::to_string(i), {{"index", i}}) += i;
+        r.histogram("Histogram"_m/std::to_string(i), simple_reservoir<int64_t, 100>())->update(i);
+    }
+
+    worker_pool workers(4);
+    snapshot_set serial(r);
+    snapshot_set parallel(r, workers);
+
+    REQUIRE(parallel.size() == serial.size());
+    for (std::size_t i = 0; i < serial.size(); i++)
+    {
+        REQUIRE(parallel[i].path() == serial[i].path());
+        REQUIRE(parallel[i].size() == serial[i].size());
+    }
+    REQUIRE(counter_value<int64_t>(parallel, {{"index", 49}}) == 49);
+}
+
+TEST_CASE("Snapshot scheduler can snapshot on several threads", "[snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    for (int i = 0; i < 50; i++)
+        *r.counter("Counter"_m/std::to_string(i), {{"index", i}}) += i;
+
+    snapshot_scheduler<decltype(r)::repository_type> subject(r, 1h, 4);
+    auto snapshots = subject.snapshot_now();
+    REQUIRE(snapshots->size() == 50);
+    REQUIRE(counter_value<int64_t>(*snapshots, {{"index", 7}}) == 7);
+}
+
+TEST_CASE("Snapshot set parallel benchmark", "[.][benchmark][snapshot_scheduler]")
+{
+    metrics_registry<> r;
+    for (int i = 0; i < 10000; i++)
+    {
+        auto& h = *r.histogram("Histogram"_m/std::to_string(i), simple_reservoir<int64_t, 1024>());
+        for (int j = 0; j < 1024; j++)
+            h.update(j * 7919 % 1024);
+    }
+
+    worker_pool workers;
+    auto time = [](auto&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto serial = time([&r]() { snapshot_set s(r); });
+    auto parallel = time([&r, &workers]() { snapshot_set s(r, workers); });
+    WARN("10000 histograms: " << serial << "ms on one thread, " << parallel << "ms on " << workers.concurrency());
+}
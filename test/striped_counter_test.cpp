@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cxxmetrics/striped_counter.hpp>
+
+using namespace cxxmetrics;
+
+TEST_CASE("Striped counter incr and wrappers work", "[striped_counter]")
+{
+    striped_counter<int64_t> a(15);
+    a += 5;
+    REQUIRE(a == 20);
+
+    ++a;
+    REQUIRE(a == 21);
+
+    a -= 16;
+    REQUIRE(a == 5);
+
+    --a;
+    REQUIRE(a == 4);
+
+    a = 10;
+    REQUIRE(a == 10);
+
+    striped_counter<int64_t> b(a);
+    REQUIRE(b == 10);
+
+    REQUIRE(a.metric_type().substr(0, 28) == "cxxmetrics::striped_counter<");
+}
+
+TEST_CASE("Striped counter sums increments from many threads", "[striped_counter]")
+{
+    static constexpr int loopcnt = 10000;
+    striped_counter<int64_t, 4> a;
+
+    std::vector<std::thread> threads;
+    threads.reserve(8);
+    for (int i = 0; i < 8; i++)
+    {
+        threads.emplace_back([&a]() {
+            for (int x = 0; x < loopcnt; x++)
+                ++a;
+        });
+    }
+
+    for (auto &thr : threads)
+        thr.join();
+
+    REQUIRE(a.value() == 8 * loopcnt);
+}
+
+TEST_CASE("Striped counter keeps cells apart without relying on alignment", "[striped_counter]")
+{
+    // heap allocations in C++14 only promise fundamental alignment, so the cells are spaced out instead
+    REQUIRE(sizeof(striped_counter<int64_t, 4>) >= 4 * 2 * internal::cache_line_size);
+
+    auto c = std::make_shared<striped_counter<int64_t, 4>>(3);
+    *c += 4;
+    REQUIRE(c->value() == 7);
+}
+
+TEST_CASE("Striped counter excercise snapshot", "[striped_counter]")
+{
+    striped_counter<int> a(15);
+    a += 7;
+    REQUIRE(a.snapshot() == 22);
+}
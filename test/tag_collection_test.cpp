@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include <cxxmetrics/tag_collection.hpp>
+
+using namespace cxxmetrics;
+
+TEST_CASE("Tag collections are the same regardless of order", "[tag_collection]")
+{
+    tag_collection a{{"service", "api"}, {"status", 200}, {"method", "GET"}};
+    tag_collection b{{"method", "GET"}, {"service", "api"}, {"status", 200}};
+    tag_collection c{{"method", "GET"}, {"service", "api"}, {"status", 404}};
+
+    REQUIRE(a == b);
+    REQUIRE(std::hash<tag_collection>()(a) == std::hash<tag_collection>()(b));
+    REQUIRE(a != c);
+    REQUIRE(tag_collection() == tag_collection());
+    REQUIRE(tag_collection() != a);
+}
+
+TEST_CASE("Tag collections are sorted by key", "[tag_collection]")
+{
+    tag_collection tags{{"zone", "west"}, {"app", "web"}, {"host", "a1"}};
+
+    std::vector<std::string> keys;
+    for (const auto& tag : tags)
+        keys.push_back(tag.first);
+
+    REQUIRE(keys == std::vector<std::string>{"app", "host", "zone"});
+    REQUIRE(tags.begin()->second == metric_value("web"));
+}
+
+TEST_CASE("Tag collections keep the first value for a key", "[tag_collection]")
+{
+    tag_collection tags{{"status", 200}, {"status", 500}};
+
+    REQUIRE(tags.size() == 1);
+    REQUIRE(tags.begin()->second == metric_value(200));
+    REQUIRE(tags == tag_collection({{"status", 200}}));
+}
+
+TEST_CASE("Tag collections hold more tags than fit inline", "[tag_collection]")
+{
+    std::map<std::string, metric_value> pairs;
+    for (int i = 0; i < 20; i++)
+        pairs.emplace("tag" + std::to_string(i), metric_value(i));
+
+    tag_collection tags(pairs);
+    tag_collection copy(tags);
+    tag_collection moved(std::move(copy));
+
+    REQUIRE(tags.size() == 20);
+    REQUIRE(moved == tags);
+
+    int total = 0;
+    for (const auto& tag : moved)
+        total += static_cast<int>(tag.second);
+    REQUIRE(total == 190);
+}
+
+TEST_CASE("Tag collection construction benchmark", "[.][benchmark][tag_collection]")
+{
+    constexpr int iterations = 1000000;
+    auto threads = std::max(2u, std::thread::hardware_concurrency());
+    std::atomic<std::size_t> total(0);
+
+    // several threads build tags at once so contention on interning the keys shows up
+    std::vector<std::thread> builders;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; t++)
+        builders.emplace_back([&total]() {
+            std::size_t sum = 0;
+            for (int i = 0; i < iterations; i++)
+            {
+                tag_collection tags{{"service", "api"}, {"status", 200}, {"method", "GET"}, {"region", "us-east"}};
+                sum += std::hash<tag_collection>()(tags);
+            }
+            total += sum;
+        });
+
+    for (auto& b : builders)
+        b.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(total != 1);
+    WARN(threads << " threads each building " << iterations << " collections of 4 tags took " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms");
+}
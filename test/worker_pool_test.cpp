@@ -0,0 +1,61 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <cxxmetrics/worker_pool.hpp>
+
+using namespace cxxmetrics;
+
+TEST_CASE("Worker pool runs every task once", "[worker_pool]")
+{
+    auto concurrency = GENERATE(as<std::size_t>(), 1, 4);
+    worker_pool subject(concurrency);
+    REQUIRE(subject.concurrency() == concurrency);
+
+    // run a few rounds to make sure the threads pick up each one
+    for (int round = 0; round < 3; round++)
+    {
+        std::vector<std::atomic<int>> runs(1000);
+        subject.run(runs.size(), [&runs](std::size_t index) {
+            runs[index]++;
+        });
+
+        REQUIRE(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int>& r) { return r == 1; }));
+    }
+}
+
+TEST_CASE("Worker pool splits items into ranges in order", "[worker_pool]")
+{
+    worker_pool subject(3);
+    REQUIRE(subject.partitions(2) == 2);
+    REQUIRE(subject.partitions(1000) == 12);
+
+    std::vector<std::pair<std::size_t, std::size_t>> ranges(subject.partitions(1000));
+    subject.partition(1000, [&ranges](std::size_t index, std::size_t begin, std::size_t end) {
+        ranges[index] = std::make_pair(begin, end);
+    });
+
+    std::size_t expected = 0;
+    for (const auto& range : ranges)
+    {
+        REQUIRE(range.first == expected);
+        REQUIRE(range.second > range.first);
+        expected = range.second;
+    }
+    REQUIRE(expected == 1000);
+}
+
+TEST_CASE("Worker pool rethrows what a task threw", "[worker_pool]")
+{
+    worker_pool subject(4);
+    REQUIRE_THROWS_AS(subject.run(100, [](std::size_t index) {
+        if (index == 42)
+            throw std::runtime_error("failed");
+    }), std::runtime_error);
+
+    // the pool is still usable afterwards
+    std::atomic<int> total(0);
+    subject.run(100, [&total](std::size_t) { total++; });
+    REQUIRE(total == 100);
+}